@@ -0,0 +1,71 @@
+// ==========================================================================
+// Vertex program for the asteroid belt stress mode
+//
+// Every rock is an instance of the same small sphere. Its position is
+// worked out here from its orbital elements and the simulation time, so
+// the belt costs the CPU nothing per frame however many rocks there are.
+// ==========================================================================
+#version 410
+
+layout(location = 0) in vec3 VertexPosition;
+#if defined(PACKED_NORMALS)
+layout(location = 1) in vec2 VertexNormal;	// octahedral encoded, see octEncode in mesh.cpp
+#elif !defined(DERIVED_NORMALS)
+layout(location = 1) in vec3 VertexNormal;
+#endif
+layout(location = 2) in vec2 UV;
+
+// per instance, see Asteroid in asteroids.h
+layout(location = 3) in vec4 AsteroidOrbit;	// x = orbit radius, y = phase, z = angular speed, w = inclination
+layout(location = 4) in vec4 AsteroidShape;	// x = radius, y = spin speed, z = texture layer
+
+out vec3 FragNormal;
+out vec2 FragUV;
+out vec4 spacePos;
+flat out int FragLayer;
+flat out int FragLit;
+
+// frame constants, written once per frame into the FrameData uniform buffer
+layout(std140) uniform FrameData {
+	mat4 cameraMatrix;
+	mat4 perspectiveMatrix;
+	vec4 lightPosition;
+	vec4 time;
+};
+
+// undoes octEncode from mesh.cpp for PACKED meshes, DERIVED_NORMALS meshes
+// are unit spheres so the normal is just the position
+vec3 objectNormal() {
+#if defined(DERIVED_NORMALS)
+	return normalize(VertexPosition);
+#elif defined(PACKED_NORMALS)
+	vec3 n = vec3(VertexNormal, 1.0 - abs(VertexNormal.x) - abs(VertexNormal.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+#else
+	return VertexNormal;
+#endif
+}
+
+void main()
+{
+	// same sense of rotation as orbitOffset in main.cpp
+	float angle = AsteroidOrbit.y - AsteroidOrbit.z * time.y;
+	vec3 center = AsteroidOrbit.x * vec3(cos(angle),
+										sin(angle) * cos(AsteroidOrbit.w),
+										sin(angle) * sin(AsteroidOrbit.w));
+
+	float spin = AsteroidShape.y * time.z;
+	mat3 rotation = mat3(cos(spin), sin(spin), 0.0,
+						-sin(spin), cos(spin), 0.0,
+						0.0, 0.0, 1.0);
+
+	FragNormal = rotation * objectNormal();
+	FragUV = UV;
+	FragLayer = int(AsteroidShape.z + 0.5);
+	FragLit = 1;
+
+	spacePos = vec4(rotation * VertexPosition * AsteroidShape.x + center, 1.0);
+	gl_Position = perspectiveMatrix * cameraMatrix * spacePos;
+}
@@ -0,0 +1,93 @@
+#include "asteroids.h"
+#include <string>
+#include <cstdlib>
+#include <cstddef>
+#include <cmath>
+
+#define PI 3.141592653589793238462643383
+
+using namespace std;
+
+bool CheckGLErrors(string location);
+
+// uniform random float in [lo, hi)
+static float randomRange(float lo, float hi)
+{
+	return lo + (hi - lo) * (rand() / (RAND_MAX + 1.f));
+}
+
+//Scatters rocks between the two radii. Speeds follow Kepler's third law
+//scaled so a rock at the earth's orbit (35 units) takes a year to go around.
+void generateAsteroids(vector<Asteroid>& asteroids, int count, float innerRadius, float outerRadius, int textureLayer)
+{
+	srand(453);		//Same belt every run, so frame times are comparable
+
+	asteroids.resize(count);
+
+	for(int i = 0; i < count; i++)
+	{
+		float radius = randomRange(innerRadius, outerRadius);
+		float period = 365.f * pow(radius / 35.f, 1.5f);
+
+		float orbitSpeed = roundf(ASTEROID_ORBIT_STEPS / period) / ASTEROID_ORBIT_STEPS;
+		float spinSpeed = roundf(ASTEROID_SPIN_STEPS * randomRange(-2.f, 2.f)) / ASTEROID_SPIN_STEPS;
+
+		Asteroid& rock = asteroids[i];
+		rock.orbit = vec4(radius, randomRange(0.f, 2.f * PI), orbitSpeed, randomRange(-0.05f, 0.05f));
+		rock.shape = vec4(randomRange(0.05f, 0.3f), spinSpeed, textureLayer, 0.f);
+	}
+}
+
+//The belt gets its own sphere mesh, and so its own VAO for the rock attributes
+bool createAsteroidBelt(AsteroidBelt& belt, int divisions, int format)
+{
+	if(!createSphereMesh(belt.mesh, 1.f, divisions, format))
+		return false;
+
+	glGenBuffers(1, &belt.buffer);
+	belt.count = 0;
+
+	glBindVertexArray(belt.mesh.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, belt.buffer);
+
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Asteroid), (void*)offsetof(Asteroid, orbit));
+	glVertexAttribDivisor(3, 1);
+
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(Asteroid), (void*)offsetof(Asteroid, shape));
+	glVertexAttribDivisor(4, 1);
+
+	glBindVertexArray(0);
+
+	return !CheckGLErrors("createAsteroidBelt");
+}
+
+//Only called when the belt size changes, never per frame
+bool loadAsteroids(AsteroidBelt& belt, const vector<Asteroid>& asteroids)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, belt.buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(Asteroid)*asteroids.size(), &asteroids[0], GL_STATIC_DRAW);
+
+	belt.count = asteroids.size();
+
+	return !CheckGLErrors("loadAsteroids");
+}
+
+//Use the asteroid program before drawing
+void drawAsteroidBelt(const AsteroidBelt& belt)
+{
+	if(belt.count == 0)
+		return;
+
+	glBindVertexArray(belt.mesh.vao);
+	glDrawElementsInstanced(GL_TRIANGLES, belt.mesh.indexCount, GL_UNSIGNED_INT, (void*)0, belt.count);
+
+	CheckGLErrors("drawAsteroidBelt");
+}
+
+void deleteAsteroidBelt(AsteroidBelt& belt)
+{
+	deleteMesh(belt.mesh);
+	glDeleteBuffers(1, &belt.buffer);
+}
@@ -0,0 +1,40 @@
+#ifndef ASTEROIDS_H
+#define ASTEROIDS_H
+
+#include <vector>
+
+#include "mesh.h"
+
+#define MIN_ASTEROIDS 1000
+#define MAX_ASTEROIDS 1000000
+
+//Orbit and spin speeds are whole multiples of 1/STEPS, so every rock's angles
+//repeat after 2 pi STEPS of simulation time. That lets the time be wrapped in
+//double before it goes to the shader as a float, which would otherwise get
+//too coarse to turn smoothly once the simulation has run a while.
+#define ASTEROID_ORBIT_STEPS 65536
+#define ASTEROID_SPIN_STEPS 256
+
+// Orbital elements of one belt rock, attributes 3 and 4 of asteroid.glsl.
+// Nothing here changes once generated, the shader works out where each rock
+// is from the simulation time, so the CPU never touches them per frame.
+struct Asteroid{
+	vec4 orbit;		// x = orbit radius, y = phase, z = angular speed, w = inclination
+	vec4 shape;		// x = radius, y = spin speed, z = texture layer
+};
+
+// A whole belt: one small sphere mesh drawn once per rock
+struct AsteroidBelt{
+	Mesh mesh;
+	GLuint buffer;
+	int count;
+};
+
+void generateAsteroids(std::vector<Asteroid>& asteroids, int count, float innerRadius, float outerRadius, int textureLayer);
+
+bool createAsteroidBelt(AsteroidBelt& belt, int divisions, int format);
+bool loadAsteroids(AsteroidBelt& belt, const std::vector<Asteroid>& asteroids);
+void drawAsteroidBelt(const AsteroidBelt& belt);
+void deleteAsteroidBelt(AsteroidBelt& belt);
+
+#endif
@@ -0,0 +1,317 @@
+#include "bench.h"
+#include "mesh.h"
+#include "transform.h"
+#include "jobs.h"
+#include "scene.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+#include <thread>
+
+using namespace std;
+
+//Wall clock seconds, only ever used for differences
+static double now()
+{
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Keeps calling run for about a quarter second, returns items per second
+//given that each call handles count of them
+template <typename Run>
+static double itemRate(Run run, int count)
+{
+	run();		//Gets any allocation or first touch out of the way
+
+	int runs = 0;
+	double start = now();
+	double elapsed;
+	do {
+		run();
+		runs++;
+		elapsed = now() - start;
+	} while(elapsed < 0.25);
+
+	return runs * (double)count / elapsed;
+}
+
+typedef bool (*SphereGenerator)(MeshData&, vec3, float, int);
+
+static double sphereRate(SphereGenerator generate, MeshData& data, int divisions)
+{
+	int vertexCount, indexCount;
+	sphereSize(divisions, vertexCount, indexCount);
+	return itemRate([&]() { generate(data, vec3(0.0), 1.f, divisions); }, vertexCount);
+}
+
+//Per vertex trig against the precomputed tables, plus how far apart their output is
+void benchmarkSphereGeneration()
+{
+	int divisions[] = {16, 64, 128, 512, 1024};
+	MeshData trig = {};
+	MeshData tables = {};
+
+	cout << "divisions   vertices   trig Mvert/s   tables Mvert/s   speedup   max difference" << endl;
+
+	for(int d : divisions)
+	{
+		double before = sphereRate(generateSphereTrig, trig, d);
+		double after = sphereRate(generateSphere, tables, d);
+
+		float difference = 0.f;
+		for(int i = 0; i < trig.vertexCount; i++)
+		{
+			difference = std::max(difference, length(trig.points[i] - tables.points[i]));
+			difference = std::max(difference, length(trig.normals[i] - tables.normals[i]));
+			difference = std::max(difference, length(trig.uvs[i] - tables.uvs[i]));
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "%9d %10d %14.1f %16.1f %8.1fx %16.2g",
+				d, trig.vertexCount, before / 1e6, after / 1e6, after / before, difference);
+		cout << line << endl;
+	}
+
+	freeMeshData(trig);
+	freeMeshData(tables);
+}
+
+//The loop rotatePlanet used to run over every vertex, every frame
+static void rotateAboutAoS(const mat3& rotation, vec3 center, vector<vec3>& points, vector<vec3>& normals)
+{
+	for(unsigned int i = 0; i < points.size(); i++)
+	{
+		points[i] = (rotation * (points[i] - center)) + center;
+		normals[i] = normalize(points[i] - center);
+	}
+}
+
+//The old AoS loop against each batch kernel, on a sky sphere sized batch and a big one
+void benchmarkTransform()
+{
+	int divisions[] = {128, 1024};
+	mat3 rotation = mat3(rotate(mat4(1.f), 0.01f, normalize(vec3(0.2, 0.3, 1.0))));
+	vec3 center = vec3(35.0, 0.0, 0.0);
+	MeshData sphere = {};
+
+	cout << "best kernel here: " << transformKernelName(bestTransformKernel()) << ", rates in Mvert/s" << endl;
+	cout << "  vertices   AoS loop";
+	for(int k = 0; k < TRANSFORM_KERNEL::COUNT; k++)
+		cout << setw(10) << transformKernelName(k) << " SoA";
+	cout << "   max difference from AoS" << endl;
+
+	for(int d : divisions)
+	{
+		generateSphere(sphere, center, 1.f, d);
+		int count = sphere.vertexCount;
+
+		vector<vec3> points(sphere.points, sphere.points + count);
+		vector<vec3> normals(sphere.normals, sphere.normals + count);
+		vector<vec3> expected = points;
+		vector<vec3> unused = normals;
+		rotateAboutAoS(rotation, center, expected, unused);
+
+		char cell[64];
+		snprintf(cell, sizeof(cell), "%10d %10.1f", count,
+				itemRate([&]() { rotateAboutAoS(rotation, center, points, normals); }, count) / 1e6);
+		cout << cell;
+
+		vector<float> soa(6 * count);
+		PointsSoA p = {&soa[0], &soa[count], &soa[2 * count], count};
+		PointsSoA n = {&soa[3 * count], &soa[4 * count], &soa[5 * count], count};
+		float difference = 0.f;
+
+		for(int k = 0; k < TRANSFORM_KERNEL::COUNT; k++)
+		{
+			//One pass from fresh points to check against the AoS loop, then time it
+			for(int i = 0; i < count; i++)
+			{
+				p.x[i] = sphere.points[i].x;
+				p.y[i] = sphere.points[i].y;
+				p.z[i] = sphere.points[i].z;
+			}
+			rotateAbout(rotation, center, p, n, k);
+
+			for(int i = 0; i < count; i++)
+				difference = std::max(difference, length(expected[i] - vec3(p.x[i], p.y[i], p.z[i])));
+
+			snprintf(cell, sizeof(cell), "%14.1f", itemRate([&]() { rotateAbout(rotation, center, p, n, k); }, count) / 1e6);
+			cout << cell;
+		}
+
+		snprintf(cell, sizeof(cell), "%26.1g", difference);
+		cout << cell << endl;
+	}
+
+	freeMeshData(sphere);
+}
+
+//A made up solar system big enough to be worth splitting up: planets with
+//moons, every body carrying a sky sphere's worth of vertices or more to spin
+#define BENCH_PLANETS 8
+#define BENCH_MOONS 3
+#define BENCH_BODY_VERTICES 131072
+#define BENCH_VERTEX_GRAIN 16384
+
+struct BenchBody{
+	int parent;
+	vec3 offset;
+	vec3 center;
+	float spin;
+	PointsSoA points;
+	PointsSoA normals;
+};
+
+//What the main loop does per body, plus the old per-vertex spin
+static void advanceBenchBody(BenchBody* bodies, int i)
+{
+	BenchBody& body = bodies[i];
+	vec3 parentCenter = body.parent >= 0 ? bodies[body.parent].center : vec3(0.0);
+	body.offset = mat3(rotate(mat4(1.f), 0.001f, vec3(0.0, 0.0, 1.0))) * body.offset;
+	body.center = parentCenter + body.offset;
+	body.spin += 0.01f;
+}
+
+static void spinBenchBody(BenchBody& body, int begin, int end)
+{
+	mat3 rotation = mat3(rotate(mat4(1.f), 0.01f, vec3(0.0, 0.0, 1.0)));
+	PointsSoA points = {body.points.x + begin, body.points.y + begin, body.points.z + begin, end - begin};
+	PointsSoA normals = {body.normals.x + begin, body.normals.y + begin, body.normals.z + begin, end - begin};
+	rotateAbout(rotation, body.center, points, normals);
+}
+
+//Body updates through the job system on 1 to maxThreads threads. Each body
+//waits on its parent, and its vertices are spun in ranges once its center
+//is known, so moons overlap with other planets' vertex work.
+void benchmarkJobs(int maxThreads)
+{
+	int count = BENCH_PLANETS * (1 + BENCH_MOONS);
+	vector<BenchBody> bodies(count);
+	vector<float> storage(6 * (size_t)BENCH_BODY_VERTICES * count, 1.f);
+
+	for(int i = 0; i < count; i++)
+	{
+		BenchBody& body = bodies[i];
+		int planet = i / (1 + BENCH_MOONS) * (1 + BENCH_MOONS);
+		body.parent = (i == planet) ? -1 : planet;
+		body.offset = vec3(i == planet ? 10.f + i : 1.f + i - planet, 0.0, 0.0);
+		body.center = vec3(0.0);
+		body.spin = 0.f;
+
+		float* base = &storage[6 * (size_t)BENCH_BODY_VERTICES * i];
+		PointsSoA points = {base, base + BENCH_BODY_VERTICES, base + 2 * BENCH_BODY_VERTICES, BENCH_BODY_VERTICES};
+		PointsSoA normals = {base + 3 * BENCH_BODY_VERTICES, base + 4 * BENCH_BODY_VERTICES, base + 5 * BENCH_BODY_VERTICES, BENCH_BODY_VERTICES};
+		body.points = points;
+		body.normals = normals;
+	}
+
+	BenchBody* data = &bodies[0];
+
+	//Straight loop on this thread, what the job system has to beat
+	double serial = 1.0 / itemRate([&]() {
+		for(int i = 0; i < count; i++)
+		{
+			advanceBenchBody(data, i);
+			spinBenchBody(data[i], 0, BENCH_BODY_VERTICES);
+		}
+	}, 1);
+
+	char line[128];
+	cout << count << " bodies of " << BENCH_BODY_VERTICES << " vertices, "
+		<< thread::hardware_concurrency() << " hardware threads" << endl;
+	snprintf(line, sizeof(line), "serial loop: %.2f ms per update", serial * 1e3);
+	cout << line << endl;
+	cout << "threads   ms/update   speedup" << endl;
+
+	for(int threads = 1; threads <= maxThreads; threads++)
+	{
+		JobSystem jobs;
+		if(!createJobSystem(jobs, threads))
+			break;
+
+		double time = 1.0 / itemRate([&]() {
+			vector<int> bodyJobs(count);
+			for(int i = 0; i < count; i++)
+			{
+				bodyJobs[i] = addJob(jobs, [data, i]() { advanceBenchBody(data, i); });
+				if(data[i].parent >= 0)
+					addDependency(jobs, bodyJobs[data[i].parent], bodyJobs[i]);
+
+				parallelFor(jobs, BENCH_BODY_VERTICES, BENCH_VERTEX_GRAIN,
+							[data, i](int begin, int end) { spinBenchBody(data[i], begin, end); }, bodyJobs[i]);
+			}
+			runJobs(jobs);
+		}, 1);
+
+		snprintf(line, sizeof(line), "%7d %11.2f %8.2fx", threads, time * 1e3, serial / time);
+		cout << line << endl;
+
+		deleteJobSystem(jobs);
+	}
+}
+
+//Scene graph updates on a big made up galaxy: stars with planets with moons.
+//Moving everything against moving a few planets, where the dirty flags only
+//redo those planets and their moons.
+void benchmarkScene()
+{
+	int stars = 100;
+	int planets = 10;
+	int moons = 9;
+	SceneGraph scene;
+	vector<int> planetNodes;
+
+	for(int s = 0; s < stars; s++)
+	{
+		int star = addNode(scene, -1, vec3(s * 100.f, 0.0, 0.0), quat(1.f, 0.f, 0.f, 0.f));
+		for(int p = 0; p < planets; p++)
+		{
+			int planet = addNode(scene, star, vec3(5.f + p, 0.0, 0.0), quat(1.f, 0.f, 0.f, 0.f));
+			planetNodes.push_back(planet);
+			for(int m = 0; m < moons; m++)
+				addNode(scene, planet, vec3(0.5f + 0.1f * m, 0.0, 0.0), quat(1.f, 0.f, 0.f, 0.f));
+		}
+	}
+	updateWorldTransforms(scene);
+
+	int count = nodeCount(scene);
+	float angle = 0.f;
+	int redone = 0;
+
+	//Every node gets a new local transform
+	double all = 1.0 / itemRate([&]() {
+		angle += 0.001f;
+		quat spin = angleAxis(angle, vec3(0.0, 0.0, 1.0));
+		for(int i = 0; i < count; i++)
+			setLocalTransform(scene, i, scene.localPosition[i], spin);
+		redone = updateWorldTransforms(scene);
+	}, 1);
+	int allRedone = redone;
+
+	//Only one planet in a hundred moves, its moons come along
+	double few = 1.0 / itemRate([&]() {
+		angle += 0.001f;
+		quat spin = angleAxis(angle, vec3(0.0, 0.0, 1.0));
+		for(unsigned int i = 0; i < planetNodes.size(); i += 100)
+			setLocalTransform(scene, planetNodes[i], scene.localPosition[planetNodes[i]], spin);
+		redone = updateWorldTransforms(scene);
+	}, 1);
+	int fewRedone = redone;
+
+	//Nothing moves at all, a paused simulation
+	double none = 1.0 / itemRate([&]() { redone = updateWorldTransforms(scene); }, 1);
+
+	char line[128];
+	cout << count << " nodes" << endl;
+	cout << "update            us/update   nodes redone" << endl;
+	snprintf(line, sizeof(line), "everything moves %11.1f %14d", all * 1e6, allRedone);
+	cout << line << endl;
+	snprintf(line, sizeof(line), "1%% of planets    %11.1f %14d", few * 1e6, fewRedone);
+	cout << line << endl;
+	snprintf(line, sizeof(line), "nothing moves    %11.1f %14d", none * 1e6, redone);
+	cout << line << endl;
+}
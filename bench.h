@@ -0,0 +1,12 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Command line benchmarks for the CPU side of things. They run instead of
+// the program, no window or GL context needed.
+
+void benchmarkSphereGeneration();
+void benchmarkTransform();
+void benchmarkJobs(int maxThreads);
+void benchmarkScene();
+
+#endif
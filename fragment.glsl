@@ -14,17 +14,31 @@ out vec4 FragmentColour;
 in vec3 FragNormal;
 in vec2 FragUV;
 in vec4 spacePos;
+flat in int FragLayer;
+flat in int FragLit;
 
-uniform sampler2D texSphere;
-uniform bool diffuse;
+// frame constants, written once per frame into the FrameData uniform buffer
+layout(std140) uniform FrameData {
+	mat4 cameraMatrix;
+	mat4 perspectiveMatrix;
+	vec4 lightPosition;
+	vec4 time;
+};
+
+// every body's texture as one layer of an array, FragLayer picks which
+uniform sampler2DArray texBodies;
+
+vec4 bodyTexture(vec2 uv) {
+	return texture(texBodies, vec3(uv, FragLayer));
+}
 
 void main(void) {
 
 	//FragmentColour = vec4((vec3(FragUV, 0.0)), 1);
-	if(diffuse) {
+	if(FragLit != 0) {
 		vec4 sunColor = vec4(1.0);
-		vec3 lightRay = normalize(vec3(0.0) - spacePos.xyz); // technically this should iterate and use the center of all light objects
-		FragmentColour = texture(texSphere, FragUV) * sunColor * max(0.2, dot(FragNormal, lightRay));
+		vec3 lightRay = normalize(lightPosition.xyz - spacePos.xyz); // technically this should iterate and use the center of all light objects
+		FragmentColour = bodyTexture(FragUV) * sunColor * max(0.2, dot(FragNormal, lightRay));
 	}
-	else FragmentColour = texture(texSphere, FragUV);
+	else FragmentColour = bodyTexture(FragUV);
 }
@@ -0,0 +1,214 @@
+#include "jobs.h"
+#include <iostream>
+#include <system_error>
+#include <algorithm>
+
+using namespace std;
+
+//Wakes one sleeping thread for a newly queued job. Taking the lock first
+//means a thread that's just checked the queues and is about to sleep can't
+//miss it.
+static void pushJob(JobSystem& jobs, int thread, int id)
+{
+	{
+		lock_guard<mutex> queue(jobs.queues[thread]->lock);
+		jobs.queues[thread]->jobs.push_back(id);
+	}
+	jobs.queued++;
+
+	lock_guard<mutex> sleeping(jobs.sleepLock);
+	jobs.wake.notify_one();
+}
+
+//Newest job from our own queue, otherwise the oldest from someone else's
+static bool popJob(JobSystem& jobs, int thread, int& id)
+{
+	int threads = jobs.queues.size();
+
+	for(int k = 0; k < threads; k++)
+	{
+		JobQueue& queue = *jobs.queues[(thread + k) % threads];
+		lock_guard<mutex> locked(queue.lock);
+		if(queue.jobs.empty())
+			continue;
+
+		if(k == 0)
+		{
+			id = queue.jobs.back();
+			queue.jobs.pop_back();
+		}
+		else
+		{
+			id = queue.jobs.front();
+			queue.jobs.pop_front();
+		}
+
+		jobs.queued--;
+		return true;
+	}
+
+	return false;
+}
+
+//Released dependents go on this thread's queue, they'll probably want the
+//data this job just touched
+static void runJob(JobSystem& jobs, int thread, int id)
+{
+	Job& job = *jobs.jobs[id];
+	job.work();
+
+	for(unsigned int i = 0; i < job.dependents.size(); i++)
+	{
+		int dependent = job.dependents[i];
+		if(--jobs.jobs[dependent]->waitingOn == 0)
+			pushJob(jobs, thread, dependent);
+	}
+
+	if(--jobs.remaining == 0)
+	{
+		lock_guard<mutex> sleeping(jobs.sleepLock);
+		jobs.wake.notify_all();
+	}
+}
+
+static void workerLoop(JobSystem& jobs, int thread)
+{
+	while(true)
+	{
+		int id;
+		if(popJob(jobs, thread, id))
+		{
+			runJob(jobs, thread, id);
+			continue;
+		}
+
+		unique_lock<mutex> sleeping(jobs.sleepLock);
+		jobs.wake.wait(sleeping, [&]() { return jobs.queued > 0 || jobs.quit; });
+		if(jobs.quit)
+			return;
+	}
+}
+
+//Starts threads - 1 workers, the thread calling runJobs makes up the rest
+bool createJobSystem(JobSystem& jobs, int threads)
+{
+	threads = std::max(threads, 1);
+	jobs.jobCount = 0;
+	jobs.queued = 0;
+	jobs.remaining = 0;
+	jobs.quit = false;
+
+	for(int i = 0; i < threads; i++)
+		jobs.queues.push_back(unique_ptr<JobQueue>(new JobQueue()));
+
+	try {
+		for(int i = 1; i < threads; i++)
+			jobs.workers.push_back(thread(workerLoop, ref(jobs), i));
+	}
+	catch(const system_error& error) {
+		cout << "Couldn't start job threads: " << error.what() << endl;
+		deleteJobSystem(jobs);
+		return false;
+	}
+
+	return true;
+}
+
+void deleteJobSystem(JobSystem& jobs)
+{
+	{
+		lock_guard<mutex> sleeping(jobs.sleepLock);
+		jobs.quit = true;
+		jobs.wake.notify_all();
+	}
+
+	for(unsigned int i = 0; i < jobs.workers.size(); i++)
+		jobs.workers[i].join();
+
+	jobs.workers.clear();
+	jobs.queues.clear();
+	jobs.jobs.clear();
+	jobs.jobCount = 0;
+}
+
+int jobThreadCount(const JobSystem& jobs)
+{
+	return jobs.queues.size();
+}
+
+int addJob(JobSystem& jobs, function<void()> work)
+{
+	if(jobs.jobCount == (int)jobs.jobs.size())
+		jobs.jobs.push_back(unique_ptr<Job>(new Job()));
+
+	Job& job = *jobs.jobs[jobs.jobCount];
+	job.work = move(work);
+	job.waitingOn = 0;
+	job.dependents.clear();
+
+	return jobs.jobCount++;
+}
+
+//after won't start until before has finished
+void addDependency(JobSystem& jobs, int before, int after)
+{
+	jobs.jobs[before]->dependents.push_back(after);
+	jobs.jobs[after]->waitingOn++;
+}
+
+int parallelFor(JobSystem& jobs, int count, int grain, function<void(int, int)> work, int after)
+{
+	int done = addJob(jobs, [](){});
+	grain = std::max(grain, 1);
+
+	for(int begin = 0; begin < count; begin += grain)
+	{
+		int end = std::min(begin + grain, count);
+		int range = addJob(jobs, [work, begin, end]() { work(begin, end); });
+
+		if(after >= 0)
+			addDependency(jobs, after, range);
+		addDependency(jobs, range, done);
+	}
+
+	if(count <= 0 && after >= 0)
+		addDependency(jobs, after, done);
+
+	return done;
+}
+
+//Queues every job that's ready, then works alongside the workers until the
+//whole batch is done. The batch is empty again afterwards.
+void runJobs(JobSystem& jobs)
+{
+	if(jobs.jobCount == 0)
+		return;
+
+	//Work out what's ready before queueing anything, once jobs start
+	//finishing they release others and those would get queued twice
+	int threads = jobs.queues.size();
+
+	jobs.remaining = jobs.jobCount;
+	for(int i = 0; i < jobs.jobCount; i++)
+		if(jobs.jobs[i]->waitingOn == 0)
+			jobs.ready.push_back(i);
+
+	for(unsigned int i = 0; i < jobs.ready.size(); i++)
+		pushJob(jobs, i % threads, jobs.ready[i]);
+	jobs.ready.clear();
+
+	while(jobs.remaining > 0)
+	{
+		int id;
+		if(popJob(jobs, 0, id))
+		{
+			runJob(jobs, 0, id);
+			continue;
+		}
+
+		unique_lock<mutex> sleeping(jobs.sleepLock);
+		jobs.wake.wait(sleeping, [&]() { return jobs.queued > 0 || jobs.remaining == 0; });
+	}
+
+	jobs.jobCount = 0;
+}
@@ -0,0 +1,64 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// One unit of work. It's only queued once every job it depends on has
+// finished, then it releases its own dependents when it's done.
+struct Job{
+	std::function<void()> work;
+	std::atomic<int> waitingOn;			// unfinished jobs this one depends on
+	std::vector<int> dependents;		// jobs waiting on this one
+};
+
+// Job ids waiting to run. The owning thread pushes and pops at the back
+// (most recently released work is still in its cache), other threads steal
+// from the front.
+struct JobQueue{
+	std::mutex lock;
+	std::deque<int> jobs;
+};
+
+// A work-stealing job system. Jobs get added to a batch along with the
+// dependencies between them, then runJobs hands the whole batch to the
+// workers and helps out until it's finished. The calling thread counts as
+// one of the threads, so createJobSystem(jobs, 1) runs everything inline.
+//
+// Job records are reused from batch to batch, so once the biggest batch has
+// been seen adding jobs doesn't allocate (beyond what std::function needs).
+struct JobSystem{
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<JobQueue>> queues;		// one per thread, 0 is the caller's
+	std::vector<std::unique_ptr<Job>> jobs;
+	int jobCount;
+	std::vector<int> ready;		// scratch for runJobs
+
+	std::atomic<int> queued;		// ids sitting in queues, workers sleep at 0
+	std::atomic<int> remaining;		// jobs in the batch not finished yet
+	std::atomic<bool> quit;
+	std::mutex sleepLock;
+	std::condition_variable wake;
+};
+
+bool createJobSystem(JobSystem& jobs, int threads);
+void deleteJobSystem(JobSystem& jobs);
+int jobThreadCount(const JobSystem& jobs);
+
+int addJob(JobSystem& jobs, std::function<void()> work);
+void addDependency(JobSystem& jobs, int before, int after);
+
+// Splits [0, count) into ranges of at most grain items, one job each, all
+// depending on after (or nothing, if it's -1). Returns a job that finishes
+// once every range has, for later jobs to depend on.
+int parallelFor(JobSystem& jobs, int count, int grain, std::function<void(int, int)> work, int after = -1);
+
+void runJobs(JobSystem& jobs);
+
+#endif
@@ -16,11 +16,17 @@
 #include <iterator>
 #include <algorithm>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
+#include <cstring>
+#include <cstdio>
 #include <ctime>
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
 
 // specify that we want the OpenGL core profile before including GLFW headers
 #define GLFW_INCLUDE_GLCOREARB
@@ -33,6 +39,14 @@
 #include "stb_image_write.h"
 
 #include "camera.h"
+#include "mesh.h"
+#include "shader.h"
+#include "asteroids.h"
+#include "bench.h"
+#include "jobs.h"
+#include "triplebuffer.h"
+#include "scene.h"
+#include "texture.h"
 
 #define PI 3.141592653589793238462643383
 
@@ -41,6 +55,7 @@ using namespace glm;
 
 //Forward definitions
 bool CheckGLErrors(string location);
+bool hasGLExtension(const char* name);
 void QueryGLVersion();
 string LoadSource(const string &filename);
 GLuint CompileShader(GLenum shaderType, const string &source);
@@ -48,15 +63,23 @@ GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader);
 
 vec2 mousePos;
 bool mousePressed = false;
-bool motion = true;
+atomic<bool> motion(true);		//Read by the simulation thread
 
-vec3 sunCenter = vec3(0.0);
-vec3 earthCenter = vec3(0.0);
-vec3 moonCenter = vec3(0.0);
 int mode = 1;
+int windowHeight = 1024;		//For turning radii into pixels
 
 Camera cam;
-float speed = 0.05;
+atomic<float> speed(0.05f);
+
+#define JUMP_DAYS 30		//How far ahead T skips
+atomic<int> jumps(0);		//T presses the simulation hasn't got to yet
+
+int asteroidCount = 0;		//Stress mode, 0 for no belt at all
+bool showStats = false;		//--stats, report frame times without the belt
+bool persistentStreams = true;		//--unpersistent-buffers forces the GL 4.1 path
+bool textureCache = true;		//--no-texture-cache decodes every image every run
+bool compressTextures = true;		//--uncompressed-textures keeps 8 bits a channel on the GPU
+int vertexFormat = VERTEX_FORMAT::PACKED | VERTEX_FORMAT::DERIVED_NORMALS;	//See VERTEX_FORMAT in mesh.h
 
 GLFWwindow* window = 0;
 
@@ -78,10 +101,12 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 
     if(key == GLFW_KEY_SPACE && action == GLFW_PRESS)
     	motion = !motion;
+    if(key == GLFW_KEY_T && action == GLFW_PRESS)
+    	jumps++;
     if(key == GLFW_KEY_UP) 
-    	speed *= 1.5;
+    	speed = speed * 1.5f;
     if(key == GLFW_KEY_DOWN) 
-    	speed *= 0.5;
+    	speed = speed * 0.5f;
     if(key == GLFW_KEY_1)  {
     	mode = 1;
     	cam.polarPos.z = 50.0;
@@ -94,6 +119,10 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
     	mode = 3;
     	cam.polarPos.z = 5.0;
     }
+    if(key == GLFW_KEY_RIGHT_BRACKET && action == GLFW_PRESS && asteroidCount > 0)
+    	asteroidCount = std::min(asteroidCount * 10, MAX_ASTEROIDS);
+    if(key == GLFW_KEY_LEFT_BRACKET && action == GLFW_PRESS && asteroidCount > 0)
+    	asteroidCount = std::max(asteroidCount / 10, MIN_ASTEROIDS);
 }
 
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
@@ -122,6 +151,7 @@ void resizeCallback(GLFWwindow* window, int width, int height)
 	glGetIntegerv(GL_VIEWPORT, vp);
 
 	glViewport(0, 0, width, height);
+	windowHeight = height;
 }
 
 void mouseScrollCallback(GLFWwindow* window, double xOffset, double yOffset) {
@@ -135,310 +165,293 @@ void mouseScrollCallback(GLFWwindow* window, double xOffset, double yOffset) {
 // TUTORIAL STUFF
 
 
-//vec2 and vec3 are part of the glm math library. 
-//Include in your own project by putting the glm directory in your project, 
-//and including glm/glm.hpp as I have at the top of the file.
-//"using namespace glm;" will allow you to avoid writing everyting as glm::vec2
-vector<vec3> points;
-vector<vec2> uvs;
-
 //Structs are simply acting as namespaces
-//Access the values like so: VAO::LINES
-struct VAO{
-	enum {GEOMETRY=0, COUNT};		//Enumeration assigns each name a value going up
-										//LINES=0, COUNT=1
+//Access the values like so: SHADER::DEFAULT
+struct SHADER{
+	enum {DEFAULT=0, ASTEROID, COUNT};
 };
 
-struct VBO{
-	enum {POINTS=0, NORMALS, UVS, INDICES, COUNT};	//POINTS=0, COLOR=1, COUNT=2
+struct BODY{
+	enum {SUN=0, EARTH, MOON, SPACE, COUNT};	//Order matters, parents have to come first
 };
 
-struct SHADER{
-	enum {DEFAULT=0, COUNT};		//LINE=0, COUNT=1
+//Every body shares the same unit sphere meshes, a chain from a handful of
+//triangles up to the old sky sphere. selectLods picks one per body per frame.
+#define LOD_COUNT 9
+#define LOD_PIXELS_PER_SEGMENT 6.f		//Rough on-screen length of a triangle edge
+
+const int lodDivisions [LOD_COUNT] = {8, 12, 16, 24, 32, 48, 64, 96, 128};
+
+//Bodies can be drawn as UV spheres or as geodesic icospheres, which spread
+//their triangles evenly instead of piling them up at the poles
+struct SHAPE{
+	enum {UV_SPHERE=0, ICOSPHERE, COUNT};
 };
 
-GLuint vbo [VBO::COUNT];		//Array which stores OpenGL's vertex buffer object handles
-GLuint vao [VAO::COUNT];		//Array which stores Vertex Array Object handles
-GLuint shader [SHADER::COUNT];		//Array which stores shader program handles
+int planetShape = SHAPE::ICOSPHERE;		//--uv-spheres for the old look
 
-//Gets handles from OpenGL
-void generateIDs()
+//Icosphere to stand in for a UV sphere of the given divisions. Its edges come
+//out between the UV sphere's ring and equator spacing with about half the triangles.
+int icosphereFrequency(int divisions)
 {
-	glGenVertexArrays(VAO::COUNT, vao);		//Tells OpenGL to create VAO::COUNT many
-														// Vertex Array Objects, and store their
-														// handles in vao array
-	glGenBuffers(VBO::COUNT, vbo);		//Tells OpenGL to create VBO::COUNT many
-													//Vertex Buffer Objects and store their
-													//handles in vbo array
+	return std::max(1, (int)round((divisions - 1) / 4.5f));
 }
 
+// Everything needed to describe a body and draw it. The sphere mesh stays in
+// object space and only the model matrix changes from frame to frame.
+//
+// Where a body is gets worked out from scratch for any animation time (see
+// placeBody), from a Kepler orbit about its parent and a steady spin, so
+// nothing builds up from step to step. Animation time counts 2 pi a day.
+// The simulation keeps the transforms in a scene graph, body i is node i.
+struct Body{
+	int parent;			// index of the body this one orbits, -1 if none
+	vec3 center;		// world space center, as drawn this frame
+	vec3 axis;			// axis for both spinning and orbiting
+	float spinRate;		// spin per unit of animation time
+	vec3 periapsis;		// direction of closest approach, as long as the semi-major axis
+	float eccentricity;	// 0 for a circle
+	float orbitRate;	// mean motion, mean anomaly per unit of animation time
+	float orbitPhase;	// mean anomaly at time 0
+	mat4 model;			// rotation + translation as drawn this frame, object space -> world space
+	float radius;		// scales the unit sphere mesh
+	int shape;			// UV sphere or icosphere, see SHAPE
+	int lod;			// which of the shared sphere meshes to draw, see selectLods
+	int texture;		// layer of bodyTextures the fragment shader samples
+	bool lit;			// diffuse lighting from the sun, or just the texture
+};
+
+//The simulation runs in fixed steps, SIM_RATE a second unless --sim-rate
+//says otherwise. Animation time moves on by speed * pi every 1/60 s whatever
+//the rate, a slower rate just takes bigger steps.
+#define SIM_RATE 60
+#define BODIES_PER_JOB 256		//Placing one body is tiny, so they're handed out in batches
+#define SIM_MAX_LAG 0.25		//Seconds behind before the simulation gives up catching up
+
+int simRate = SIM_RATE;
+
+// Where a body is after a simulation step
+struct BodyState{
+	vec3 center;
+	quat rotation;
+};
+
+// Everything the render thread needs from the simulation: the last two
+// steps, so it can draw anywhere in between them
+struct Snapshot{
+	BodyState previous [BODY::COUNT];
+	BodyState current [BODY::COUNT];
+	double previousTime;	// animation time at each step, the belt's orbits run off this
+	double currentTime;
+	double due;				// clock time the current step was for, see simulationLoop
+};
+
+Body bodies [BODY::COUNT];			//The render thread's, placed from the latest snapshot each frame
+Body simBodies [BODY::COUNT];		//The simulation thread's own copy, nothing else touches it
+SceneGraph simScene;				//And where it's put them, node i for body i
+TripleBuffer<Snapshot> snapshots;	//Simulation thread -> render thread
+atomic<bool> simRunning;
+#define BODY_TEXTURE_WIDTH 4096		//Every body's image gets resampled to this
+#define BODY_TEXTURE_HEIGHT 2048
+TextureArray bodyTextures;			//Layer i for body i, bound once for the whole run
+TextureLoader textureLoader;		//Decodes the images above while the first frames draw
+
+Mesh meshes [SHAPE::COUNT][LOD_COUNT];		//Unit spheres, uploaded once at startup
+#define STREAM_FRAME_BYTES (64 * 1024)		//Per frame, instances and uniforms together
+StreamBuffer stream;		//Everything rewritten each frame goes through here
+AsteroidBelt belt;		//Only filled in stress mode
+JobSystem jobs;		//Worker threads for the simulation thread's body updates
+int jobThreads = std::max((int)thread::hardware_concurrency(), 1);		//--threads N to override
+ShaderProgram shader [SHADER::COUNT];		//Array which stores shader programs and their uniforms
+
 //Clean up IDs when you're done using them
 void deleteIDs()
 {
 	for(int i=0; i<SHADER::COUNT; i++)
 	{
-		glDeleteProgram(shader[i]);
+		deleteShaderProgram(shader[i]);
 	}
 	
-	glDeleteVertexArrays(VAO::COUNT, vao);
-	glDeleteBuffers(VBO::COUNT, vbo);	
-}
-
-
-//Describe the setup of the Vertex Array Object
-bool initVAO()
-{
-	glBindVertexArray(vao[VAO::GEOMETRY]);		//Set the active Vertex Array
-
-	glEnableVertexAttribArray(0);		//Tell opengl you're using layout attribute 0 (For shader input)
-	glBindBuffer( GL_ARRAY_BUFFER, vbo[VBO::POINTS] );		//Set the active Vertex Buffer
-	glVertexAttribPointer(
-		0,				//Attribute
-		3,				//Size # Components
-		GL_FLOAT,	//Type
-		GL_FALSE, 	//Normalized?
-		sizeof(vec3),	//Stride
-		(void*)0			//Offset
-		);
-
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo[VBO::NORMALS]);
-	glVertexAttribPointer(
-		1,				//Attribute
-		3,				//Size # Components
-		GL_FLOAT,	//Type
-		GL_FALSE, 	//Normalized?
-		sizeof(vec3),	//Stride
-		(void*)0			//Offset
-		);
-	
-	glEnableVertexAttribArray(2);		//Tell opengl you're using layout attribute 1
-	glBindBuffer(GL_ARRAY_BUFFER, vbo[VBO::UVS]);
-	glVertexAttribPointer(
-		2,
-		2,
-		GL_FLOAT,
-		GL_FALSE,
-		sizeof(vec2),
-		(void*)0
-		);	
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo[VBO::INDICES]);
-
-	return !CheckGLErrors("initVAO");		//Check for errors in initialize
-}
+	for(int i=0; i<LOD_COUNT; i++)
+	{
+		deleteMesh(meshes[SHAPE::UV_SPHERE][i]);
+		deleteMesh(meshes[SHAPE::ICOSPHERE][i]);
+	}
 
+	deleteAsteroidBelt(belt);
+	deleteTextureArray(bodyTextures);
 
-//Loads buffers with data
-bool loadBuffer(const vector<vec3>& points, const vector<vec3> normals, 
-				const vector<vec2>& uvs, const vector<unsigned int>& indices)
-{
-	glBindBuffer(GL_ARRAY_BUFFER, vbo[VBO::POINTS]);
-	glBufferData(
-		GL_ARRAY_BUFFER,				//Which buffer you're loading too
-		sizeof(vec3)*points.size(),	//Size of data in array (in bytes)
-		&points[0],							//Start of array (&points[0] will give you pointer to start of vector)
-		GL_DYNAMIC_DRAW						//GL_DYNAMIC_DRAW if you're changing the data often
-												//GL_STATIC_DRAW if you're changing seldomly
-		);
-
-	glBindBuffer(GL_ARRAY_BUFFER, vbo[VBO::NORMALS]);
-	glBufferData(
-		GL_ARRAY_BUFFER,				//Which buffer you're loading too
-		sizeof(vec3)*normals.size(),	//Size of data in array (in bytes)
-		&normals[0],							//Start of array (&points[0] will give you pointer to start of vector)
-		GL_DYNAMIC_DRAW						//GL_DYNAMIC_DRAW if you're changing the data often
-												//GL_STATIC_DRAW if you're changing seldomly
-		);
-
-	glBindBuffer(GL_ARRAY_BUFFER, vbo[VBO::UVS]);
-	glBufferData(
-		GL_ARRAY_BUFFER,
-		sizeof(vec2)*uvs.size(),
-		&uvs[0],
-		GL_STATIC_DRAW
-		);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo[VBO::INDICES]);
-	glBufferData(
-		GL_ELEMENT_ARRAY_BUFFER,
-		sizeof(unsigned int)*indices.size(),
-		&indices[0],
-		GL_STATIC_DRAW
-		);
-
-	return !CheckGLErrors("loadBuffer");	
+	deleteStreamBuffer(stream);
 }
 
 //Compile and link shaders, storing the program ID in shader array
 bool initShader()
 {	
-	string vertexSource = LoadSource("vertex.glsl");		//Put vertex file text into string
-	string fragmentSource = LoadSource("fragment.glsl");		//Put fragment file text into string
-
-	GLuint vertexID = CompileShader(GL_VERTEX_SHADER, vertexSource);
-	GLuint fragmentID = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
-	
-	shader[SHADER::DEFAULT] = LinkProgram(vertexID, fragmentID);	//Link and store program ID in shader array
+	//Link and store program in shader array, uniforms get looked up here too
+	string defines = vertexFormatDefines(vertexFormat);		//Shaders have to read what the meshes store
 
-	return !CheckGLErrors("initShader");
+	bool ok = createShaderProgram(shader[SHADER::DEFAULT], "vertex.glsl", "fragment.glsl", defines);
+	ok &= createShaderProgram(shader[SHADER::ASTEROID], "asteroid.glsl", "fragment.glsl", defines);
+	return ok;
 }
 
-//For reference:
-//	https://open.gl/textures
-GLuint createTexture(const char* filename)
+//Initialization
+void initGL()
 {
-	int components;
-	GLuint texID;
-	int tWidth, tHeight;
 
-	//stbi_set_flip_vertically_on_load(true);
-	unsigned char* data = stbi_load(filename, &tWidth, &tHeight, &components, 0);
-	
-	if(data != NULL)
-	{
-		glGenTextures(1, &texID);
-		glBindTexture(GL_TEXTURE_2D, texID);
+//	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-		if(components==3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tWidth, tHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		else if(components==4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tWidth, tHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	//Only call these once - meshes set up their own VAOs in createMesh
+	initShader();		//Create shader and store program ID
+	createStreamBuffer(stream, STREAM_FRAME_BYTES, persistentStreams);		//Per-frame uniforms and instances
+	createTextureArray(bodyTextures, BODY::COUNT, BODY_TEXTURE_WIDTH, BODY_TEXTURE_HEIGHT, compressTextures);
 
-		//Clean up
-		glBindTexture(GL_TEXTURE_2D, 0);
-		stbi_image_free(data);
+	for(int i=0; i<LOD_COUNT; i++)
+	{
+		createSphereMesh(meshes[SHAPE::UV_SPHERE][i], 1.f, lodDivisions[i], vertexFormat);
+		createIcosphereMesh(meshes[SHAPE::ICOSPHERE][i], icosphereFrequency(lodDivisions[i]), vertexFormat);
+	}
 
-		return texID;
-	} 
-	
-	return 0;	//Error
+	createAsteroidBelt(belt, 8, vertexFormat);		//Rocks are tiny, a handful of triangles will do
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
 }
 
-//Use program before loading texture
-//	texUnit can be - GL_TEXTURE0, GL_TEXTURE1, etc...
-bool loadTexture(GLuint texID, GLuint texUnit, GLuint program, const char* uniformName)
+//Uniforms that are the same for every draw, written once per frame
+void loadFrameUniforms(Camera* cam, mat4 perspectiveMatrix, vec3 lightPosition, double simTime)
 {
-	glActiveTexture(texUnit);
-	glBindTexture(GL_TEXTURE_2D, texID);
-	
-	GLuint uniformLocation = glGetUniformLocation(program, uniformName);
-	glUniform1i(uniformLocation, 0);
-		
-	return !CheckGLErrors("loadTexture");
+	FrameData data;
+	data.cameraMatrix = cam->getMatrix();
+	data.perspectiveMatrix = perspectiveMatrix;
+	data.lightPosition = vec4(lightPosition, 1.0);
+	data.time = vec4(glfwGetTime(),
+					fmod(simTime, 2.0 * PI * ASTEROID_ORBIT_STEPS),		//Wrapped in double, see asteroids.h
+					fmod(simTime, 2.0 * PI * ASTEROID_SPIN_STEPS), 0.0);
+
+	loadFrameData(stream, data);
+
+	glUseProgram(shader[SHADER::DEFAULT].id);
 }
 
-// fun fact: did you know planets are just elaborate spheres? Believe it.
-void generateSphere(vector<vec3>& positions, vector<vec3>& normals, 
-					vector<vec2>& uvs, vector<unsigned int>& indices,
-					vec3 center, float radius, int divisions)
+//Picks each body's sphere from how big it is on screen. A sphere of n
+//divisions has n-1 segments around its equator, so aim for segments of about
+//LOD_PIXELS_PER_SEGMENT pixels and take the first level with at least that many.
+void selectLods(Body* bodies, int count, Camera* cam, mat4 perspectiveMatrix)
 {
-	float step = 1.f / (float)(divisions - 1);
-	float u = 0.f;
-
-	// Traversing the planes of time and space
-	for (int i = 0; i < divisions; i++) {
-		float v = 0.f;
-
-		//Traversing the planes of time and space (again)
-		for (int j = 0; j < divisions; j++) {
-			vec3 pos = vec3(	radius * cos(2.f * PI * u) * sin(PI * v),
-								radius * sin(2.f * PI * u) * sin(PI * v),
-								radius * cos(PI * v)) + center;
-
-			vec3 normal = normalize(pos - center);
-			
-			positions.push_back(pos);
-			normals.push_back(normal);
-			uvs.push_back(vec2(u, v));
-
-			v += step;
-		}
+	vec3 eye = vec3(inverse(cam->getMatrix())[3]);
 
-		u += step;
-	}
+	//Pixels covered by one unit at distance one
+	float pixelScale = perspectiveMatrix[1][1] * windowHeight * 0.5f;
 
-	for(int i = 0; i < divisions - 1; i++)
+	for(int i = 0; i < count; i++)
 	{
-		for(int j = 0; j < divisions - 1; j++)
+		Body& body = bodies[i];
+		float distance = length(body.center - eye);
+
+		//From inside (the sky) or right up against it, always use the best
+		if(distance <= body.radius)
 		{
-			unsigned int p00 = i * divisions + j;
-			unsigned int p01 = i * divisions + j + 1;
-			unsigned int p10 = (i + 1) * divisions + j;
-			unsigned int p11 = (i + 1) * divisions + j + 1;
-
-			indices.push_back(p00);
-			indices.push_back(p10);
-			indices.push_back(p01);
-
-			indices.push_back(p01);
-			indices.push_back(p10);
-			indices.push_back(p11);
+			body.lod = LOD_COUNT - 1;
+			continue;
 		}
+
+		float pixelRadius = body.radius * pixelScale / distance;
+		float segments = 2.f * (float)PI * pixelRadius / LOD_PIXELS_PER_SEGMENT;
+
+		body.lod = 0;
+		while(body.lod < LOD_COUNT - 1 && lodDivisions[body.lod] - 1 < segments)
+			body.lod++;
 	}
 }
 
-//Initialization
-void initGL()
+//Draws every body, with one instanced draw per shape and level of detail in use
+void render(const Body* bodies, int count)
 {
+	//Bucket the instances by mesh so each one's records are contiguous
+	const int buckets = SHAPE::COUNT * LOD_COUNT;
+	int bucketCount[buckets] = {0};
+	int bucketFirst[buckets];
+	for(int i = 0; i < count; i++)
+		bucketCount[bodies[i].shape * LOD_COUNT + bodies[i].lod]++;
+
+	int next[buckets];
+	for(int i = 0, first = 0; i < buckets; first += bucketCount[i], i++)
+		bucketFirst[i] = next[i] = first;
+
+	//Written straight into the stream, there's no copy kept around
+	GLintptr offset;
+	Instance* instances = (Instance*)mapStream(stream, sizeof(Instance)*count, sizeof(vec4), offset);
+	if(!instances)
+	{
+		cout << "ERROR: no room left to stream " << count << " instances" << endl;
+		return;
+	}
 
-//	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	for(int i = 0; i < count; i++)
+	{
+		const Body& body = bodies[i];
+		Instance& instance = instances[next[body.shape * LOD_COUNT + body.lod]++];
 
-	//Only call these once - don't call again every time you change geometry
-	generateIDs();		//Create VertexArrayObjects and Vertex Buffer Objects and store their handles
-	initShader();		//Create shader and store program ID
+		instance.transform = body.model;
+		instance.params = vec4(body.radius, body.texture, body.lit ? 1.0 : 0.0, 0.0);
+	}
+	unmapStream(stream);
 
-	initVAO();			//Describe setup of Vertex Array Objects and Vertex Buffer Object
+	for(int i = 0; i < buckets; i++)
+	{
+		if(bucketCount[i] == 0)
+			continue;
+
+		Mesh& mesh = meshes[i / LOD_COUNT][i % LOD_COUNT];
+		bindInstances(mesh, stream.buffer, offset + bucketFirst[i]*sizeof(Instance));
+
+		glDrawElementsInstanced(
+				GL_TRIANGLES,			//What shape we're drawing	- GL_TRIANGLES, GL_LINES, GL_POINTS, GL_QUADS, GL_TRIANGLE_STRIP
+				mesh.indexCount,		//How many indices
+				GL_UNSIGNED_INT,		//Type
+				(void*)0,				//Offset
+				bucketCount[i]			//How many bodies
+				);
+	}
 
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LEQUAL);
+	CheckGLErrors("render");
 }
 
-//Draws buffers to screen
-void render(Camera* cam, mat4 perspectiveMatrix, mat4 modelview, int startElement, int numElements)
+//Regenerates the belt whenever the requested size changes
+void updateAsteroids()
 {
-	
-	//Don't need to call these on every draw, so long as they don't change
-	glUseProgram(shader[SHADER::DEFAULT]);		//Use LINE program
-	glBindVertexArray(vao[VAO::GEOMETRY]);		//Use the LINES vertex array
-
-	glUseProgram(shader[SHADER::DEFAULT]);
+	if(belt.count == asteroidCount)
+		return;
 
-	mat4 camMatrix = cam->getMatrix();
+	vector<Asteroid> asteroids;
+	generateAsteroids(asteroids, asteroidCount, 60.f, 150.f, BODY::MOON);
+	loadAsteroids(belt, asteroids);
+}
 
-	glUniformMatrix4fv(glGetUniformLocation(shader[SHADER::DEFAULT], "cameraMatrix"),
-						1,
-						false,
-						&camMatrix[0][0]);
+//Prints the average frame time about once a second while the belt is up (or
+//with --stats), so scaling can be tracked against the number of bodies
+void reportFrameTime(double& reportStart, int& reportFrames)
+{
+	reportFrames++;
 
-	glUniformMatrix4fv(glGetUniformLocation(shader[SHADER::DEFAULT], "perspectiveMatrix"),
-						1,
-						false,
-						&perspectiveMatrix[0][0]);
+	double now = glfwGetTime();
+	if(now - reportStart < 1.0)
+		return;
 
-	glUniformMatrix4fv(glGetUniformLocation(shader[SHADER::DEFAULT], "modelviewMatrix"),
-						1,
-						false,
-						&modelview[0][0]);
-	
-	CheckGLErrors("loadUniforms");
+	double frameMs = 1000.0 * (now - reportStart) / reportFrames;
+	int count = belt.count + BODY::COUNT;
+	cout << "bodies: " << count << "  frame: " << frameMs << " ms  ("
+		 << frameMs * 1e6 / count << " ns/body)  streamed: " << stream.bytesLastFrame
+		 << " bytes/frame (" << (stream.persistent ? "persistent" : "mapped per write")
+		 << ", " << stream.stalls << " stalls)" << endl;
 
-	glDrawElements(
-			GL_TRIANGLES,		//What shape we're drawing	- GL_TRIANGLES, GL_LINES, GL_POINTS, GL_QUADS, GL_TRIANGLE_STRIP
-			numElements,		//How many indices
-			GL_UNSIGNED_INT,	//Type
-			(void*)0			//Offset
-			);
-
-	CheckGLErrors("render");
+	reportStart = now;
+	reportFrames = 0;
 }
 
-void rotatePlanet(vector<vec3>& points, vector<vec3>& normals, vec3 center, vec3 axis, float theta) {
+// same rotation the old per-vertex loops used, now only applied per body
+mat3 rotationMatrix(vec3 axis, float theta) {
 	axis = normalize(axis);
 	float x = axis.x;
 	float y = axis.y;
@@ -447,42 +460,262 @@ void rotatePlanet(vector<vec3>& points, vector<vec3>& normals, vec3 center, vec3
 	float y2 = y * y;
 	float z2 = z * z;
 
-	mat3 rMat = mat3(	cos(theta) + x2 * (1 - cos(theta)), x * y * (1 - cos(theta)) - z * sin(theta), x * z * (1 - cos(theta)) + y * sin(theta),
-						y * x * (1 - cos(theta)) + z * sin(theta), cos(theta) + y2 * (1 - cos(theta)), y * z * (1 - cos(theta)) - x * sin(theta),
-						z * x * (1 - cos(theta)) - y * sin(theta), z * y * (1 - cos(theta)) + x * sin(theta), cos(theta) + z2 * (1 - cos(theta)));
+	return mat3(	cos(theta) + x2 * (1 - cos(theta)), x * y * (1 - cos(theta)) - z * sin(theta), x * z * (1 - cos(theta)) + y * sin(theta),
+					y * x * (1 - cos(theta)) + z * sin(theta), cos(theta) + y2 * (1 - cos(theta)), y * z * (1 - cos(theta)) - x * sin(theta),
+					z * x * (1 - cos(theta)) - y * sin(theta), z * y * (1 - cos(theta)) + x * sin(theta), cos(theta) + z2 * (1 - cos(theta)));
+}
 
-	for (int i = 0; i < points.size(); i++) {
-		points[i] = (rMat * (points[i] - center)) + center;
-		normals[i] = normalize(points[i] - center);
-	}
+// a body sitting at offset from its parent, spinning about z
+Body makeBody(int parent, vec3 offset, float radius, int shape, int texture, bool lit) {
+	Body body;
+	body.parent = parent;
+	body.center = vec3(0.0);
+	body.axis = vec3(0.0, 0.0, 1.0);
+	body.spinRate = 0.f;
+	body.periapsis = offset;
+	body.eccentricity = 0.f;
+	body.orbitRate = 0.f;
+	body.orbitPhase = 0.f;
+	body.model = mat4(1.f);
+	body.radius = radius;
+	body.shape = shape;
+	body.lod = LOD_COUNT - 1;
+	body.texture = texture;
+	body.lit = lit;
+	return body;
+}
+
+// Kepler's equation, M = E - e sin E, solved for the eccentric anomaly E by
+// Newton's method. Always the same number of iterations, so the same inputs
+// give the same bits every time. Plenty for anything short of e = 0.9.
+#define KEPLER_ITERATIONS 6
 
+double eccentricAnomaly(double meanAnomaly, double eccentricity) {
+	double E = meanAnomaly + eccentricity * sin(meanAnomaly);
+	for (int i = 0; i < KEPLER_ITERATIONS; i++)
+		E -= (E - eccentricity * sin(E) - meanAnomaly) / (1.0 - eccentricity * cos(E));
+	return E;
 }
 
-void orbitPlanet(vector<vec3>& points, vector<vec3>& normals, vec3& childCenter, vec3 parentCenter, vec3 axis, float theta) {
-	axis = normalize(axis);
-	float x = axis.x;
-	float y = axis.y;
-	float z = axis.z;
-	float x2 = x * x;
-	float y2 = y * y;
-	float z2 = z * z;
+// where a body is relative to its parent at the given animation time. A
+// positive rate goes round the way rotationMatrix turns for a positive angle.
+vec3 orbitOffset(const Body& body, double time) {
+	if (body.orbitRate == 0.f)
+		return body.periapsis;
+
+	double a = length(body.periapsis);
+	double e = body.eccentricity;
+	double M = fmod(body.orbitPhase + body.orbitRate * time, 2.0 * PI);
+	double E = eccentricAnomaly(M, e);
 
-	rotatePlanet(points, normals, childCenter, axis, -theta);
+	// periapsis and a quarter turn on from it, the orbit's own x and y
+	vec3 p = body.periapsis / (float)a;
+	vec3 q = rotationMatrix(body.axis, PI / 2) * p;
 
-	mat3 rMat = mat3(	cos(theta) + x2 * (1 - cos(theta)), x * y * (1 - cos(theta)) - z * sin(theta), x * z * (1 - cos(theta)) + y * sin(theta),
-						y * x * (1 - cos(theta)) + z * sin(theta), cos(theta) + y2 * (1 - cos(theta)), y * z * (1 - cos(theta)) - x * sin(theta),
-						z * x * (1 - cos(theta)) - y * sin(theta), z * y * (1 - cos(theta)) + x * sin(theta), cos(theta) + z2 * (1 - cos(theta)));
+	return p * (float)(a * (cos(E) - e)) + q * (float)(a * sqrt(1.0 - e * e) * sin(E));
+}
+
+// sets a body's node to where it is relative to its parent at the given
+// animation time. Doesn't need the parent placed first.
+void placeBody(SceneGraph& scene, const Body* bodies, int i, double time) {
+	float spin = (float)fmod(bodies[i].spinRate * time, 2.0 * PI);
+	setLocalTransform(scene, i, orbitOffset(bodies[i], time), quat_cast(rotationMatrix(bodies[i].axis, spin)));
+}
 
-	childCenter = (rMat * (childCenter - parentCenter)) + parentCenter;
+// every body's local transform in parallel, then one pass through the scene
+// graph for the world transforms once they're all in
+void placeBodies(JobSystem& jobs, SceneGraph& scene, const Body* bodies, int count, double time) {
+	SceneGraph* graph = &scene;
+	int placed = parallelFor(jobs, count, BODIES_PER_JOB, [graph, bodies, time](int begin, int end) {
+		for (int i = begin; i < end; i++)
+			placeBody(*graph, bodies, i, time);
+	});
 
-	for (int i = 0; i < points.size(); i++) {
-		points[i] = (rMat * (points[i] - parentCenter)) + parentCenter;
-		normals[i] = normalize(points[i] - childCenter);
+	int world = addJob(jobs, [graph]() { updateWorldTransforms(*graph); });
+	addDependency(jobs, placed, world);
+
+	runJobs(jobs);
+}
+
+// seconds on a clock both threads share
+double clockSeconds() {
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// where every body is right now
+void recordStates(BodyState* states, const SceneGraph& scene) {
+	for (int i = 0; i < BODY::COUNT; i++) {
+		states[i].center = scene.worldPosition[i];
+		states[i].rotation = scene.localRotation[i];
 	}
+}
 
+// places the render thread's bodies alpha of the way from the previous step
+// to the current one
+void applySnapshot(Body* bodies, const Snapshot& snapshot, float alpha) {
+	for (int i = 0; i < BODY::COUNT; i++) {
+		const BodyState& from = snapshot.previous[i];
+		const BodyState& to = snapshot.current[i];
+
+		bodies[i].center = mix(from.center, to.center, alpha);
+		bodies[i].model = translate(mat4(1.f), bodies[i].center) * mat4_cast(slerp(from.rotation, to.rotation, alpha));
+	}
 }
 
+// The simulation thread. Steps its own copy of the bodies at a fixed rate and
+// publishes the last two steps after each batch, without touching GL or the
+// camera, so a slow frame doesn't hold up the simulation or the other way
+// around.
+//
+// Step n is due at start + n / simRate. Every step that's come due gets run,
+// so the simulation keeps time however long a batch takes, and after n steps
+// it's always in the same place whatever the frame rate was. If it ever falls
+// more than SIM_MAX_LAG behind (say the process was stopped) it skips ahead
+// instead of rushing through the backlog.
+void simulationLoop() {
+	double step = 1.0 / simRate;
+	double start = clockSeconds();
+	long long steps = 0;
+	double simTime = 0.0;
+
+	BodyState previous [BODY::COUNT];
+	recordStates(previous, simScene);
+
+	while (simRunning) {
+		double now = clockSeconds();
+		if (now - (start + steps * step) > SIM_MAX_LAG)
+			start = now - (steps + 1) * step;
+
+		double previousTime = simTime;
+		bool stepped = false;
+
+		while (start + (steps + 1) * step <= now) {
+			recordStates(previous, simScene);
+			previousTime = simTime;
+
+			if(motion)
+				simTime += speed * PI * SIM_RATE / simRate;
+
+			//Jumps land straight away, no sweeping across the gap
+			int jumped = jumps.exchange(0);
+			if(jumped != 0)
+				simTime += jumped * JUMP_DAYS * 2.0 * PI;
+
+			placeBodies(jobs, simScene, simBodies, BODY::COUNT, simTime);
+			if(jumped != 0) {
+				recordStates(previous, simScene);
+				previousTime = simTime;
+			}
+
+			steps++;
+			stepped = true;
+		}
+
+		if (stepped) {
+			Snapshot& snapshot = writeSlot(snapshots);
+			copy(previous, previous + BODY::COUNT, snapshot.previous);
+			recordStates(snapshot.current, simScene);
+			snapshot.previousTime = previousTime;
+			snapshot.currentTime = simTime;
+			snapshot.due = start + steps * step;
+			publishSlot(snapshots);
+		}
 
+		this_thread::sleep_for(chrono::duration<double>(start + (steps + 1) * step - clockSeconds()));
+	}
+}
+
+
+//Everything but the belt, seen from the body picked with 1/2/3
+void drawBodies(mat4 perspectiveMatrix)
+{
+	//Draw in between the last two simulation steps. The current step
+	//shows in full a step after it was due, so motion stays smooth at
+	//any frame rate for one step of lag.
+	const Snapshot& snapshot = latestSlot(snapshots);
+	float alpha = clamp((float)((clockSeconds() - snapshot.due) * simRate), 0.f, 1.f);
+	double simTime = mix(snapshot.previousTime, snapshot.currentTime, (double)alpha);
+	applySnapshot(bodies, snapshot, alpha);
+
+	if(mode == 1)
+		cam = Camera(cam.polarPos, -bodies[BODY::SUN].center, bodies[BODY::SUN].radius);
+	if(mode == 2)
+		cam = Camera(cam.polarPos, -bodies[BODY::EARTH].center, bodies[BODY::EARTH].radius);
+	if(mode == 3)
+		cam = Camera(cam.polarPos, -bodies[BODY::MOON].center, bodies[BODY::MOON].radius);
+
+	loadFrameUniforms(&cam, perspectiveMatrix, bodies[BODY::SUN].center, simTime);
+
+	uploadLoadedTextures(textureLoader, bodyTextures);
+
+	selectLods(bodies, BODY::COUNT, &cam, perspectiveMatrix);
+	render(bodies, BODY::COUNT);
+}
+
+#define TEXTURE_BENCH_FRAMES 16
+
+//GPU time to draw the bodies from each of the 1/2/3 views with each filter.
+//Texture fetches are most of the work there, so it's a fair stand in for
+//texture bandwidth. Runs once the window's up, rather than with the others.
+void benchmarkTextures(mat4 perspectiveMatrix)
+{
+	//Everything has to be in first, mip levels and all
+	while(uploadLoadedTextures(textureLoader, bodyTextures, BODY::COUNT) > 0)
+		this_thread::sleep_for(chrono::milliseconds(10));
+
+	const char* views [3] = {"sun", "earth", "moon"};
+	float distances [3] = {50.0, 10.0, 5.0};		//Where 1/2/3 put the camera
+
+	GLuint query;
+	glGenQueries(1, &query);
+
+	cout << "GPU time per frame (ms) by filter, " << TEXTURE_BENCH_FRAMES << " frames each" << endl;
+	cout << "view      ";
+	for(int filter = 0; filter < TEXTURE_FILTER::COUNT; filter++)
+	{
+		char column [32];
+		snprintf(column, sizeof(column), "%12s", textureFilterName(filter));
+		cout << column;
+	}
+	cout << endl;
+
+	for(int view = 0; view < 3; view++)
+	{
+		mode = view + 1;
+		cam.polarPos.z = distances[view];
+
+		char row [64];
+		snprintf(row, sizeof(row), "%-10s", views[view]);
+		cout << row;
+
+		for(int filter = 0; filter < TEXTURE_FILTER::COUNT; filter++)
+		{
+			setTextureFilter(bodyTextures, filter);
+
+			double total = 0.0;
+			for(int frame = -2; frame < TEXTURE_BENCH_FRAMES; frame++)		//A couple to warm up
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glBeginQuery(GL_TIME_ELAPSED, query);
+				drawBodies(perspectiveMatrix);
+				glEndQuery(GL_TIME_ELAPSED);
+				endStreamFrame(stream);
+
+				GLuint64 elapsed = 0;
+				glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);		//Waits for the GPU
+				if(frame >= 0)
+					total += elapsed * 1e-6;
+			}
+
+			snprintf(row, sizeof(row), "%12.3f", total / TEXTURE_BENCH_FRAMES);
+			cout << row;
+		}
+		cout << endl;
+	}
+
+	glDeleteQueries(1, &query);
+	CheckGLErrors("benchmarkTextures");
+}
 
 
 // ==========================================================================
@@ -490,9 +723,58 @@ void orbitPlanet(vector<vec3>& points, vector<vec3>& normals, vec3& childCenter,
 
 int main(int argc, char *argv[])
 {   
+	string benchmark;
+	for(int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if(arg == "--asteroids" && i + 1 < argc)
+			asteroidCount = std::min(std::max(atoi(argv[++i]), MIN_ASTEROIDS), MAX_ASTEROIDS);
+		if(arg == "--float-vertices")
+			vertexFormat &= ~VERTEX_FORMAT::PACKED;
+		if(arg == "--uv-spheres")
+			planetShape = SHAPE::UV_SPHERE;
+		if(arg == "--sim-rate" && i + 1 < argc)
+			simRate = std::min(std::max(atoi(argv[++i]), 1), 1000);
+		if(arg == "--threads" && i + 1 < argc)
+			jobThreads = std::max(atoi(argv[++i]), 1);
+		if(arg == "--stats")
+			showStats = true;
+		if(arg == "--unpersistent-buffers")
+			persistentStreams = false;
+		if(arg == "--no-texture-cache")
+			textureCache = false;
+		if(arg == "--uncompressed-textures")
+			compressTextures = false;
+		if(arg == "--stored-normals")
+			vertexFormat &= ~VERTEX_FORMAT::DERIVED_NORMALS;
+		if(arg.compare(0, 8, "--bench-") == 0)
+			benchmark = arg;
+	}
+
+	//Benchmarks run instead of the program, after every other flag is read
+	if(benchmark == "--bench-sphere")
+		benchmarkSphereGeneration();
+	if(benchmark == "--bench-transform")
+		benchmarkTransform();
+	if(benchmark == "--bench-jobs")
+		benchmarkJobs(std::max(jobThreads, 4));
+	if(benchmark == "--bench-scene")
+		benchmarkScene();
+	if(!benchmark.empty() && benchmark != "--bench-textures")
+		return 0;
+
+	//Get the images decoding straight away, the window and meshes can be
+	//made meanwhile. Bodies get a plain colour until theirs is uploaded.
+	addTextureLoad(textureLoader, BODY::SUN, "sun.jpg");
+	addTextureLoad(textureLoader, BODY::EARTH, "earth.jpg");
+	addTextureLoad(textureLoader, BODY::MOON, "moonyy.jpg");
+	addTextureLoad(textureLoader, BODY::SPACE, "space1.png");
+	startTextureLoads(textureLoader, jobThreads, BODY_TEXTURE_WIDTH, BODY_TEXTURE_HEIGHT, textureCache, compressTextures);
+
     // initialize the GLFW windowing system
     if (!glfwInit()) {
         cout << "ERROR: GLFW failed to initilize, TERMINATING" << endl;
+        finishTextureLoads(textureLoader);
         return -1;
     }
     glfwSetErrorCallback(ErrorCallback);
@@ -505,6 +787,7 @@ int main(int argc, char *argv[])
     window = glfwCreateWindow(1024, 1024, "CPSC 453 OpenGL Boilerplate", 0, 0);
     if (!window) {
         cout << "Program failed to create GLFW window, TERMINATING" << endl;
+        finishTextureLoads(textureLoader);
         glfwTerminate();
         return -1;
     }
@@ -521,65 +804,71 @@ int main(int argc, char *argv[])
     QueryGLVersion();
 
 	initGL();
+	createJobSystem(jobs, jobThreads);
 
+	//Frame times are the whole point of stress mode, so don't cap them at vsync
+	if(asteroidCount > 0)
+		glfwSwapInterval(0);
 
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	float distScale = 35.0 / 149597870.7; // AU in km
 	float radScale = 1.0 / 6378.1; // E in km
 
 	// make sun
-	vector<vec3> sunPoints;
-	vector<vec3> sunNormals;
-	vector<vec2> sunUvs;
-	vector<unsigned int> sunIndices;
-	sunCenter = vec3(0.0);
 	float sunRadius = pow(radScale * 696000.0, 0.5);
-	generateSphere(sunPoints, sunNormals, sunUvs, sunIndices, sunCenter, sunRadius, 96);
-	GLuint sun = createTexture("sun.jpg");
+	bodies[BODY::SUN] = makeBody(-1, vec3(0.0), sunRadius, planetShape, BODY::SUN, false);
+	bodies[BODY::SUN].spinRate = 1.f / 25.38f;		// in earth days
+	fillTextureLayer(bodyTextures, BODY::SUN, vec3(1.0, 0.6, 0.2));
 
 	// make earth
-	vector<vec3> earthPoints;
-	vector<vec3> earthNormals;
-	vector<vec2> earthUvs;
-	vector<unsigned int> earthIndices;
-	earthCenter = vec3(distScale * 149597890, 0.0, 0.0);
 	float earthRadius = pow(radScale * 6378.1, 0.5);
-	generateSphere(earthPoints, earthNormals, earthUvs, earthIndices, earthCenter, earthRadius, 72);
-	GLuint earth = createTexture("earth.jpg");
+	bodies[BODY::EARTH] = makeBody(BODY::SUN, vec3(distScale * 149597890, 0.0, 0.0), earthRadius, planetShape, BODY::EARTH, true);
+	bodies[BODY::EARTH].orbitRate = 1.f / 365.f;
+	bodies[BODY::EARTH].eccentricity = 0.0167f;
+	bodies[BODY::EARTH].spinRate = -1.f;
+	fillTextureLayer(bodyTextures, BODY::EARTH, vec3(0.2, 0.3, 0.5));
 
 	// make moon
-	vector<vec3> moonPoints;
-	vector<vec3> moonNormals;
-	vector<vec2> moonUvs;
-	vector<unsigned int> moonIndices;
-	moonCenter = earthCenter - vec3((20 * distScale * 384399.0), 0.0, 0.0);
 	float moonRadius = pow(radScale * 1737.1 / 2, 0.5);
-	generateSphere(moonPoints, moonNormals, moonUvs, moonIndices, moonCenter, moonRadius, 48);
-	GLuint moon = createTexture("moonyy.jpg");
+	bodies[BODY::MOON] = makeBody(BODY::EARTH, -vec3((20 * distScale * 384399.0), 0.0, 0.0), moonRadius, planetShape, BODY::MOON, true);
+	bodies[BODY::MOON].orbitRate = 1.f / 27.32f;
+	bodies[BODY::MOON].eccentricity = 0.0549f;
+	bodies[BODY::MOON].spinRate = 1.f / 27.32f;		// tidally locked
+	fillTextureLayer(bodyTextures, BODY::MOON, vec3(0.5, 0.5, 0.5));
 	
 	// make space
-	vector<vec3> spacePoints;
-	vector<vec3> spaceNormals;
-	vector<vec2> spaceUvs;
-	vector<unsigned int> spaceIndices;
-	vec3 spaceCenter = vec3(0.0);
-	generateSphere(spacePoints, spaceNormals, spaceUvs, spaceIndices, spaceCenter, 400.0, 128);
-	GLuint space = createTexture("space1.png");
-	
+	bodies[BODY::SPACE] = makeBody(-1, vec3(0.0), 400.0, SHAPE::UV_SPHERE, BODY::SPACE, false);
+	bodies[BODY::SPACE].spinRate = 1.f / 5000.f;
+	fillTextureLayer(bodyTextures, BODY::SPACE, vec3(0.02, 0.02, 0.03));
+
+	//From here on the simulation thread moves its own copy of the bodies
+	copy(bodies, bodies + BODY::COUNT, simBodies);
+	for(int i = 0; i < BODY::COUNT; i++)
+		addNode(simScene, bodies[i].parent, vec3(0.0), quat(1.f, 0.f, 0.f, 0.f));
+	placeBodies(jobs, simScene, simBodies, BODY::COUNT, 0.0);
+
+	Snapshot start;
+	recordStates(start.previous, simScene);
+	recordStates(start.current, simScene);
+	start.previousTime = start.currentTime = 0.f;
+	start.due = clockSeconds();
+	initTripleBuffer(snapshots, start);
+	simRunning = true;
+	thread simulation(simulationLoop);
 	
 	// direction, position
 	cam = Camera(vec3(-1.63994, 0.0607855, 50.0), vec3(0.0, 0.0, 0.0), sunRadius);
 	//float fovy, float aspect, float zNear, float zFar
 	mat4 perspectiveMatrix = perspective(radians(80.f), 1.f, 0.1f, 1000.f); 
 
-	float scale; 
-	float sunRot;
-	float earthOrb;
-	float earthRot;
-	float moonOrb; 
-	float moonRot;
-	float spaceRot;
-	GLuint diffUniformLocation;
+	if(benchmark == "--bench-textures")
+	{
+		benchmarkTextures(perspectiveMatrix);
+		glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
+	double reportStart = glfwGetTime();
+	int reportFrames = 0;
 
     // run an event-triggered main loop
     while (!glfwWindowShouldClose(window))
@@ -591,60 +880,17 @@ int main(int argc, char *argv[])
 
 		// cout << cam.polarPos.z << endl;
 
-		scale = speed * PI;
-		sunRot = scale / 25.38;
-		earthOrb = scale / 365;
-		earthRot = -scale;
-		moonOrb = scale / 27.32;
-		moonRot = scale / 27.32;
-		spaceRot = scale / 5000;
-
-		if(mode == 1)
-			cam = Camera(cam.polarPos, -sunCenter, sunRadius);
-		if(mode == 2)
-			cam = Camera(cam.polarPos, -earthCenter, earthRadius);
-		if(mode == 3)
-			cam = Camera(cam.polarPos, -moonCenter, moonRadius);
-
-        // call function to draw our scene
-        if(motion) {
-        	rotatePlanet(sunPoints, sunNormals, sunCenter, vec3(0.0, 0.0, 1.0), sunRot);
-        	orbitPlanet(earthPoints, earthNormals, earthCenter, sunCenter, vec3(0.0, 0.0, 1.0), earthOrb);
-        	rotatePlanet(earthPoints, earthNormals, earthCenter, vec3(0.0, 0.0, 1.0), earthRot);
-        	orbitPlanet(moonPoints, moonNormals, moonCenter, earthCenter, vec3(0.0, 0.0, 1.0), moonOrb);
-        	rotatePlanet(moonPoints, moonNormals, moonCenter, vec3(0.0, 0.0, 1.0), moonRot);
-        	rotatePlanet(spacePoints, spaceNormals, spaceCenter, vec3(0.0, 0.0, 1.0), spaceRot);
+		drawBodies(perspectiveMatrix);
+
+        if(asteroidCount > 0) {
+        	updateAsteroids();
+        	glUseProgram(shader[SHADER::ASTEROID].id);
+        	drawAsteroidBelt(belt);
         }
 
-        glUseProgram(shader[SHADER::DEFAULT]);
-
-        loadBuffer(sunPoints, sunNormals, sunUvs, sunIndices);
-        loadTexture(sun, GL_TEXTURE0, shader[SHADER::DEFAULT], "texSphere");
-        diffUniformLocation = glGetUniformLocation(shader[SHADER::DEFAULT], "diffuse");
-        glUniform1i(diffUniformLocation, false); // change this to sunDiffuse or something in your free time because this is sloppy
-        render(&cam, perspectiveMatrix, mat4(1.f), 0, sunIndices.size());
-        
-
-        loadBuffer(earthPoints, earthNormals, earthUvs, earthIndices);
-        loadTexture(earth, GL_TEXTURE0, shader[SHADER::DEFAULT], "texSphere");
-        diffUniformLocation = glGetUniformLocation(shader[SHADER::DEFAULT], "diffuse");
-        glUniform1i(diffUniformLocation, true);
-        render(&cam, perspectiveMatrix, mat4(1.f), 0, earthIndices.size());
-        
-        
-        loadBuffer(moonPoints, moonNormals, moonUvs, moonIndices);
-        loadTexture(moon, GL_TEXTURE0, shader[SHADER::DEFAULT], "texSphere");
-        diffUniformLocation = glGetUniformLocation(shader[SHADER::DEFAULT], "diffuse");
-        glUniform1i(diffUniformLocation, true);
-        render(&cam, perspectiveMatrix, mat4(1.f), 0, moonIndices.size());
-        
-
-		loadBuffer(spacePoints, spaceNormals, spaceUvs, spaceIndices);
-        loadTexture(space, GL_TEXTURE0, shader[SHADER::DEFAULT], "texSphere");
-        diffUniformLocation = glGetUniformLocation(shader[SHADER::DEFAULT], "diffuse");
-        glUniform1i(diffUniformLocation, false);
-        render(&cam, perspectiveMatrix, mat4(1.f), 0, spaceIndices.size());
-        
+        endStreamFrame(stream);		//Everything that reads this frame's uploads is queued now
+        if(asteroidCount > 0 || showStats)
+        	reportFrameTime(reportStart, reportFrames);
 
         // scene is rendered to the back buffer, so swap to front for display
         glfwSwapBuffers(window);
@@ -654,7 +900,11 @@ int main(int argc, char *argv[])
 	}
 
 	// clean up allocated resources before exit
+   	simRunning = false;
+   	simulation.join();
+   	finishTextureLoads(textureLoader);
    	deleteIDs();
+   	deleteJobSystem(jobs);
 	glfwDestroyWindow(window);
    	glfwTerminate();
 
@@ -667,6 +917,17 @@ int main(int argc, char *argv[])
 // --------------------------------------------------------------------------
 // OpenGL utility functions
 
+//Looks through the context's extension strings, one at a time as core profile wants
+bool hasGLExtension(const char* name)
+{
+	GLint extensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+	for(GLint i = 0; i < extensions; i++)
+		if(strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0)
+			return true;
+	return false;
+}
+
 void QueryGLVersion()
 {
     // query opengl version and renderer information
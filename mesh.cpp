@@ -0,0 +1,642 @@
+#include "mesh.h"
+#include "meshopt.h"
+#include <string>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define PI 3.141592653589793238462643383
+
+using namespace std;
+
+bool CheckGLErrors(string location);
+
+//Carves the four arrays out of one block. The block only gets replaced when
+//it's too small, so building a smaller mesh into old data is free.
+bool allocateMeshData(MeshData& data, int vertexCount, int indexCount)
+{
+	size_t size = vertexCount * (2*sizeof(vec3) + sizeof(vec2)) + indexCount * sizeof(unsigned int);
+
+	if(size > data.capacity)
+	{
+		free(data.block);
+		data.block = (unsigned char*)malloc(size);
+		data.capacity = data.block ? size : 0;
+
+		if(!data.block)
+		{
+			cout << "Couldn't allocate " << size << " bytes of mesh data" << endl;
+			return false;
+		}
+	}
+
+	data.points = (vec3*)data.block;
+	data.normals = data.points + vertexCount;
+	data.uvs = (vec2*)(data.normals + vertexCount);
+	data.indices = (unsigned int*)(data.uvs + vertexCount);
+	data.vertexCount = vertexCount;
+	data.indexCount = indexCount;
+
+	return true;
+}
+
+void freeMeshData(MeshData& data)
+{
+	free(data.block);
+	data = MeshData();
+}
+
+//A divisions x divisions grid of vertices, two triangles per grid cell
+void sphereSize(int divisions, int& vertexCount, int& indexCount)
+{
+	vertexCount = divisions * divisions;
+	indexCount = (divisions - 1) * (divisions - 1) * 6;
+}
+
+//Two triangles per grid cell, the same for both sphere generators
+static void sphereIndices(MeshData& data, int divisions)
+{
+	unsigned int* index = data.indices;
+
+	for(int i = 0; i < divisions - 1; i++)
+	{
+		for(int j = 0; j < divisions - 1; j++)
+		{
+			unsigned int p00 = i * divisions + j;
+			unsigned int p01 = i * divisions + j + 1;
+			unsigned int p10 = (i + 1) * divisions + j;
+			unsigned int p11 = (i + 1) * divisions + j + 1;
+
+			*index++ = p00;
+			*index++ = p10;
+			*index++ = p01;
+
+			*index++ = p01;
+			*index++ = p10;
+			*index++ = p11;
+		}
+	}
+}
+
+// fun fact: did you know planets are just elaborate spheres? Believe it.
+// This is the original version, four trig calls per vertex. generateSphere
+// builds exactly the same sphere, --bench-sphere races the two.
+bool generateSphereTrig(MeshData& data, vec3 center, float radius, int divisions)
+{
+	int vertexCount, indexCount;
+	sphereSize(divisions, vertexCount, indexCount);
+	if(!allocateMeshData(data, vertexCount, indexCount))
+		return false;
+
+	float step = 1.f / (float)(divisions - 1);
+	float u = 0.f;
+	int vertex = 0;
+
+	// Traversing the planes of time and space
+	for (int i = 0; i < divisions; i++) {
+		float v = 0.f;
+
+		//Traversing the planes of time and space (again)
+		for (int j = 0; j < divisions; j++) {
+			vec3 pos = vec3(	radius * cos(2.f * PI * u) * sin(PI * v),
+								radius * sin(2.f * PI * u) * sin(PI * v),
+								radius * cos(PI * v)) + center;
+
+			data.points[vertex] = pos;
+			data.normals[vertex] = normalize(pos - center);
+			data.uvs[vertex] = vec2(u, v);
+			vertex++;
+
+			v += step;
+		}
+
+		u += step;
+	}
+
+	sphereIndices(data, divisions);
+	return true;
+}
+
+#ifdef __SSE2__
+//Transposes x, y and z of four vertices into four packed vec3s
+static inline void storeVec3x4(vec3* out, __m128 x, __m128 y, __m128 z)
+{
+	__m128 xy01 = _mm_unpacklo_ps(x, y);
+	__m128 xy23 = _mm_unpackhi_ps(x, y);
+	__m128 z0x1 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0));
+	__m128 y1z1 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1));
+	__m128 z2x3 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2));
+	__m128 y3z3 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3));
+
+	float* f = (float*)out;
+	_mm_storeu_ps(f, _mm_shuffle_ps(xy01, z0x1, _MM_SHUFFLE(2, 0, 1, 0)));
+	_mm_storeu_ps(f + 4, _mm_shuffle_ps(y1z1, xy23, _MM_SHUFFLE(1, 0, 2, 0)));
+	_mm_storeu_ps(f + 8, _mm_shuffle_ps(z2x3, y3z3, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+#endif
+
+//One ring of the sphere, all at the same u. The meridian tables hold v and
+//sin/cos of pi v for every vertex down the ring, so there's no trig in here.
+//Four vertices at a time with SSE2, the leftovers one at a time.
+static void sphereRing(vec3* points, vec3* normals, vec2* uvs, int count, float u, float cosU, float sinU,
+					const float* v, const float* sinV, const float* cosV, vec3 center, float radius)
+{
+	int j = 0;
+
+#ifdef __SSE2__
+	__m128 cu = _mm_set1_ps(cosU);
+	__m128 su = _mm_set1_ps(sinU);
+	__m128 uu = _mm_set1_ps(u);
+	__m128 r = _mm_set1_ps(radius);
+	__m128 cx = _mm_set1_ps(center.x);
+	__m128 cy = _mm_set1_ps(center.y);
+	__m128 cz = _mm_set1_ps(center.z);
+
+	for(; j + 4 <= count; j += 4)
+	{
+		__m128 sv = _mm_load_ps(sinV + j);
+		__m128 nx = _mm_mul_ps(cu, sv);
+		__m128 ny = _mm_mul_ps(su, sv);
+		__m128 nz = _mm_load_ps(cosV + j);
+
+		storeVec3x4(normals + j, nx, ny, nz);
+		storeVec3x4(points + j,	_mm_add_ps(_mm_mul_ps(nx, r), cx),
+								_mm_add_ps(_mm_mul_ps(ny, r), cy),
+								_mm_add_ps(_mm_mul_ps(nz, r), cz));
+
+		__m128 vv = _mm_load_ps(v + j);
+		_mm_storeu_ps((float*)(uvs + j), _mm_unpacklo_ps(uu, vv));
+		_mm_storeu_ps((float*)(uvs + j + 2), _mm_unpackhi_ps(uu, vv));
+	}
+#endif
+
+	for(; j < count; j++)
+	{
+		vec3 normal = vec3(cosU * sinV[j], sinU * sinV[j], cosV[j]);
+		points[j] = normal * radius + center;
+		normals[j] = normal;
+		uvs[j] = vec2(u, v[j]);
+	}
+}
+
+//Same sphere as generateSphereTrig. Every ring shares the same column of
+//v values, so sin and cos of pi v are worked out once per mesh and each ring
+//only needs its own cos/sin of 2 pi u. The unit normal falls out for free.
+bool generateSphere(MeshData& data, vec3 center, float radius, int divisions)
+{
+	if(divisions > MAX_SPHERE_DIVISIONS)
+	{
+		cout << "Spheres can have at most " << MAX_SPHERE_DIVISIONS << " divisions" << endl;
+		return false;
+	}
+
+	int vertexCount, indexCount;
+	sphereSize(divisions, vertexCount, indexCount);
+	if(!allocateMeshData(data, vertexCount, indexCount))
+		return false;
+
+	alignas(16) float v[MAX_SPHERE_DIVISIONS];
+	alignas(16) float sinV[MAX_SPHERE_DIVISIONS];
+	alignas(16) float cosV[MAX_SPHERE_DIVISIONS];
+
+	//Stepping u and v the same way as the original keeps the UVs bit identical
+	float step = 1.f / (float)(divisions - 1);
+	float t = 0.f;
+	for(int j = 0; j < divisions; j++)
+	{
+		v[j] = t;
+		sinV[j] = sin(PI * t);
+		cosV[j] = cos(PI * t);
+		t += step;
+	}
+
+	float u = 0.f;
+	for(int i = 0; i < divisions; i++)
+	{
+		int ring = i * divisions;
+		sphereRing(data.points + ring, data.normals + ring, data.uvs + ring, divisions,
+				u, cos(2.f * PI * u), sin(2.f * PI * u), v, sinV, cosV, center, radius);
+		u += step;
+	}
+
+	sphereIndices(data, divisions);
+	return true;
+}
+
+//Texture coordinates matching generateSphere's parameterization, so the same
+//textures work on both: x = cos(2 pi u) sin(pi v), y = ..., z = cos(pi v)
+static vec2 sphereUv(vec3 p)
+{
+	float u = atan2(p.y, p.x) / (2.f * PI);
+	if(u < 0.f)
+		u += 1.f;
+
+	return vec2(u, acos(clamp(p.z, -1.f, 1.f)) / PI);
+}
+
+//Every face has frequency^2 triangles and the 10f^2 + 2 grid points are
+//shared. On top of that the 3f - 1 vertices the seam runs through get a
+//wrapped copy, and each of the 10 pole triangles gets its own pole vertex.
+void icosphereSize(int frequency, int& vertexCount, int& indexCount)
+{
+	vertexCount = 10 * frequency * frequency + 2 + 3 * frequency - 1 + 10;
+	indexCount = 60 * frequency * frequency;
+}
+
+//A geodesic sphere: an icosahedron with each face split into frequency^2
+//triangles, pushed out onto the unit sphere. Triangles come out almost the
+//same size everywhere, so there's none of the UV sphere's crowding at the
+//poles. The icosahedron is stood on a vertex so the poles are vertices too.
+bool generateIcosphere(MeshData& data, int frequency)
+{
+	if(frequency < 1 || frequency > MAX_ICOSPHERE_FREQUENCY)
+	{
+		cout << "Icospheres need a frequency from 1 to " << MAX_ICOSPHERE_FREQUENCY << endl;
+		return false;
+	}
+
+	int vertexCount, indexCount;
+	icosphereSize(frequency, vertexCount, indexCount);
+	if(!allocateMeshData(data, vertexCount, indexCount))
+		return false;
+
+	vec3* positions = data.points;
+	vec2* uvs = data.uvs;
+	unsigned int* indices = data.indices;
+	int vertex = 0;
+	int index = 0;
+
+	//Top, upper ring of 5, lower ring of 5 (offset by a fifth of a turn), bottom
+	vec3 corners[12];
+	float ringZ = 1.f / sqrt(5.f);
+	float ringR = 2.f / sqrt(5.f);
+
+	corners[0] = vec3(0.0, 0.0, 1.0);
+	for(int k = 0; k < 5; k++)
+	{
+		float upper = 2.f * PI * k / 5.f;
+		float lower = upper + PI / 5.f;
+		corners[1 + k] = vec3(ringR * cos(upper), ringR * sin(upper), ringZ);
+		corners[6 + k] = vec3(ringR * cos(lower), ringR * sin(lower), -ringZ);
+	}
+	corners[11] = vec3(0.0, 0.0, -1.0);
+
+	int faces[20][3];
+	for(int k = 0; k < 5; k++)
+	{
+		int k1 = (k + 1) % 5;
+		int f[4][3] = {	{0, 1 + k, 1 + k1},
+						{1 + k, 6 + k, 1 + k1},
+						{1 + k1, 6 + k, 6 + k1},
+						{11, 6 + k1, 6 + k}};
+		for(int j = 0; j < 4; j++)
+			for(int c = 0; c < 3; c++)
+				faces[k*4 + j][c] = f[j][c];
+	}
+
+	//Grid points are shared along face edges. Each one is keyed by its corner
+	//weights in corner order, which is the same whichever face it comes from,
+	//and built by summing in that order too so shared points match exactly.
+	map<unsigned long long, unsigned int> shared;
+	vector<unsigned int> grid((frequency + 1) * (frequency + 2) / 2);
+	vector<unsigned char> pole;		// per vertex, set for the two corner vertices at z = +-1
+
+	for(int f = 0; f < 20; f++)
+	{
+		for(int i = 0; i <= frequency; i++)
+		{
+			for(int j = 0; j <= frequency - i; j++)
+			{
+				int weight[3] = {frequency - i - j, i, j};
+				int order[3] = {0, 1, 2};
+				sort(order, order + 3, [&](int a, int b) { return faces[f][a] < faces[f][b]; });
+
+				//The seam at u = 0 runs down from the top through corner 1, and
+				//then halfway between corners 6 and 10 to the bottom. Points on
+				//it are picked out by their weights, floats can't be trusted to
+				//land y on the right side of 0.
+				unsigned long long key = 0;
+				vec3 sum = vec3(0.0);
+				int w6 = 0, w10 = 0;
+				bool seam = true;
+				for(int c = 0; c < 3; c++)
+				{
+					int corner = faces[f][order[c]];
+					int w = weight[order[c]];
+					if(w == 0)
+						continue;
+
+					key = (key << 16) | (corner << 8) | w;
+					sum += corners[corner] * (float)w;
+
+					if(corner == 6)
+						w6 = w;
+					else if(corner == 10)
+						w10 = w;
+					else if(corner != 0 && corner != 1 && corner != 11)
+						seam = false;
+				}
+
+				map<unsigned long long, unsigned int>::iterator found = shared.find(key);
+				if(found == shared.end())
+				{
+					bool isPole = key == (unsigned long long)frequency || key == (unsigned long long)((11 << 8) | frequency);
+					seam = seam && w6 == w10 && !isPole;
+					if(seam)
+						sum.y = 0.f;
+
+					//Seam points sit at u = 1, so every triangle they're in on
+					//the u = 0 side is one that straddles it and copies them
+					vec3 pos = normalize(sum);
+					positions[vertex] = pos;
+					uvs[vertex] = seam ? vec2(1.f, sphereUv(pos).y) : sphereUv(pos);
+					pole.push_back(isPole);
+					found = shared.insert(make_pair(key, (unsigned int)vertex++)).first;
+				}
+
+				//Row i starts after the i rows above it, which get shorter each time
+				grid[i * (frequency + 1) - i * (i - 1) / 2 + j] = found->second;
+			}
+		}
+
+		for(int i = 0; i < frequency; i++)
+		{
+			int row = i * (frequency + 1) - i * (i - 1) / 2;
+			int nextRow = (i + 1) * (frequency + 1) - (i + 1) * i / 2;
+
+			for(int j = 0; j < frequency - i; j++)
+			{
+				indices[index++] = grid[row + j];
+				indices[index++] = grid[nextRow + j];
+				indices[index++] = grid[row + j + 1];
+
+				if(j < frequency - i - 1)
+				{
+					indices[index++] = grid[row + j + 1];
+					indices[index++] = grid[nextRow + j];
+					indices[index++] = grid[nextRow + j + 1];
+				}
+			}
+		}
+	}
+
+	//Fix up the seam. Triangles straddling u = 0 get their high u vertices
+	//swapped for copies at u - 1, which GL_REPEAT samples the same way. Pole
+	//vertices have no real u, so each triangle gets its own copy with the
+	//average u of its other two corners.
+	vector<int> wrapped(vertex, -1);
+
+	for(int t = 0; t < indexCount; t += 3)
+	{
+		float lo = 1.f;
+		float hi = 0.f;
+		for(int c = 0; c < 3; c++)
+		{
+			unsigned int v = indices[t + c];
+			if(pole[v])
+				continue;
+			lo = std::min(lo, uvs[v].x);
+			hi = std::max(hi, uvs[v].x);
+		}
+
+		for(int c = 0; c < 3 && hi - lo > 0.5f; c++)
+		{
+			unsigned int v = indices[t + c];
+			if(pole[v] || uvs[v].x < 0.5f)
+				continue;
+
+			if(wrapped[v] < 0)
+			{
+				if(vertex == vertexCount)
+					return false;		//Only if icosphereSize is wrong, but don't write past the positions
+				wrapped[v] = vertex;
+				positions[vertex] = positions[v];
+				uvs[vertex] = uvs[v] - vec2(1.0, 0.0);
+				vertex++;
+			}
+			indices[t + c] = wrapped[v];
+		}
+
+		for(int c = 0; c < 3; c++)
+		{
+			unsigned int v = indices[t + c];
+			if(v >= pole.size() || !pole[v])
+				continue;
+			if(vertex == vertexCount)
+				return false;
+
+			float u = 0.5f * (uvs[indices[t + (c + 1) % 3]].x + uvs[indices[t + (c + 2) % 3]].x);
+			indices[t + c] = vertex;
+			positions[vertex] = positions[v];
+			uvs[vertex] = vec2(u, uvs[v].y);
+			vertex++;
+		}
+	}
+
+	//Unit sphere, so the normals are just the positions
+	memcpy(data.normals, positions, vertexCount * sizeof(vec3));
+
+	return vertex == vertexCount && index == indexCount;
+}
+
+//Maps a unit vector onto the octahedron and unfolds it into [-1, 1]^2
+vec2 octEncode(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 p = vec2(n.x, n.y);
+
+	if(n.z < 0.f)
+		p = (vec2(1.f) - abs(vec2(n.y, n.x))) * vec2(n.x >= 0.f ? 1.f : -1.f, n.y >= 0.f ? 1.f : -1.f);
+
+	return p;
+}
+
+//What the vertex shaders need defined to read this format
+string vertexFormatDefines(int format)
+{
+	if(format & VERTEX_FORMAT::DERIVED_NORMALS)
+		return "#define DERIVED_NORMALS\n";
+
+	return (format & VERTEX_FORMAT::PACKED) ? "#define PACKED_NORMALS\n" : "";
+}
+
+static GLshort toSnorm16(float x)
+{
+	return (GLshort)round(clamp(x, -1.f, 1.f) * 32767.f);
+}
+
+
+//Vertex streams for the FLOAT format, one VBO per attribute
+static void loadFloatVertices(Mesh& mesh, const MeshData& data, bool storeNormals)
+{
+	glEnableVertexAttribArray(0);		//Tell opengl you're using layout attribute 0 (For shader input)
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[VBO::POINTS]);		//Set the active Vertex Buffer
+	glBufferData(
+		GL_ARRAY_BUFFER,				//Which buffer you're loading too
+		sizeof(vec3)*data.vertexCount,	//Size of data in array (in bytes)
+		data.points,						//Start of array
+		GL_STATIC_DRAW						//Never touched again after this
+		);
+	glVertexAttribPointer(
+		0,				//Attribute
+		3,				//Size # Components
+		GL_FLOAT,	//Type
+		GL_FALSE, 	//Normalized?
+		sizeof(vec3),	//Stride
+		(void*)0			//Offset
+		);
+
+	if(storeNormals)
+	{
+		glEnableVertexAttribArray(1);
+		glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[VBO::NORMALS]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(vec3)*data.vertexCount, data.normals, GL_STATIC_DRAW);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
+	}
+	
+	glEnableVertexAttribArray(2);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[VBO::UVS]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vec2)*data.vertexCount, data.uvs, GL_STATIC_DRAW);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), (void*)0);
+}
+
+//One interleaved stream for the PACKED format, the GPU normalizes the integers back.
+//Vertices are packed straight into the mapped buffer, no staging copy.
+static void loadPackedVertices(Mesh& mesh, const MeshData& data, bool storeNormals)
+{
+	//Without normals each vertex just stops before PackedVertex::normal
+	GLsizei stride = storeNormals ? sizeof(PackedVertex) : offsetof(PackedVertex, normal);
+
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[VBO::POINTS]);
+	glBufferData(GL_ARRAY_BUFFER, stride * data.vertexCount, NULL, GL_STATIC_DRAW);
+	unsigned char* vertices = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, stride * data.vertexCount,
+												GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+	for(int i = 0; vertices && i < data.vertexCount; i++)
+	{
+		PackedVertex vertex;
+		vec2 normal = octEncode(data.normals[i]);
+
+		vertex.position[0] = toSnorm16(data.points[i].x);
+		vertex.position[1] = toSnorm16(data.points[i].y);
+		vertex.position[2] = toSnorm16(data.points[i].z);
+		vertex.position[3] = 0;
+		vertex.uv[0] = toSnorm16(data.uvs[i].x);
+		vertex.uv[1] = toSnorm16(data.uvs[i].y);
+		vertex.normal[0] = toSnorm16(normal.x);
+		vertex.normal[1] = toSnorm16(normal.y);
+
+		memcpy(vertices + i * stride, &vertex, stride);
+	}
+
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, position));
+
+	if(storeNormals)
+	{
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, normal));
+	}
+
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, uv));
+}
+
+//Creates the VAO and buffers for a mesh and uploads the data, once
+bool createMesh(Mesh& mesh, const MeshData& data, int format)
+{
+	glGenVertexArrays(1, &mesh.vao);
+	glGenBuffers(VBO::COUNT, mesh.vbo);
+
+	glBindVertexArray(mesh.vao);		//Set the active Vertex Array
+
+	bool storeNormals = !(format & VERTEX_FORMAT::DERIVED_NORMALS);
+
+	if(format & VERTEX_FORMAT::PACKED)
+		loadPackedVertices(mesh, data, storeNormals);
+	else
+		loadFloatVertices(mesh, data, storeNormals);
+
+	//The element buffer binding is part of the VAO state
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbo[VBO::INDICES]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int)*data.indexCount, data.indices, GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+
+	mesh.indexCount = data.indexCount;
+	mesh.format = format;
+
+	return !CheckGLErrors("createMesh");
+}
+
+//Meshes get built in here before going to the GPU. The memory is kept for the
+//next mesh, so after the biggest one nothing more is allocated.
+static MeshData building = {};
+static MeshData reordering = {};
+
+//Generates a sphere around the origin, reorders it for the vertex cache and
+//uploads it. The CPU copy is only kept as scratch for the next mesh.
+bool createSphereMesh(Mesh& mesh, float radius, int divisions, int format)
+{
+	if(!generateSphere(building, vec3(0.0), radius, divisions))
+		return false;
+
+	char name[64];
+	snprintf(name, sizeof(name), "sphere %d", divisions);
+	if(!optimizeMesh(building, reordering, name))
+		return false;
+
+	return createMesh(mesh, building, format);
+}
+
+//Points the mesh's instance attributes at a range of Instance records.
+//Base instances need GL 4.2, so instead the attribute offsets are moved.
+void bindInstances(Mesh& mesh, GLuint buffer, GLintptr offset)
+{
+	glBindVertexArray(mesh.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	//A mat4 attribute takes up four locations, one per column
+	for(int i = 0; i < 4; i++)
+	{
+		glEnableVertexAttribArray(3 + i);
+		glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)(offset + i*sizeof(vec4)));
+		glVertexAttribDivisor(3 + i, 1);
+	}
+
+	glEnableVertexAttribArray(7);
+	glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)(offset + offsetof(Instance, params)));
+	glVertexAttribDivisor(7, 1);
+}
+
+//Clean up IDs when you're done using them
+void deleteMesh(Mesh& mesh)
+{
+	glDeleteVertexArrays(1, &mesh.vao);
+	glDeleteBuffers(VBO::COUNT, mesh.vbo);
+}
+
+//Same as createSphereMesh, for a geodesic sphere
+bool createIcosphereMesh(Mesh& mesh, int frequency, int format)
+{
+	if(!generateIcosphere(building, frequency))
+		return false;
+
+	char name[64];
+	snprintf(name, sizeof(name), "icosphere %d", frequency);
+	if(!optimizeMesh(building, reordering, name))
+		return false;
+
+	return createMesh(mesh, building, format);
+}
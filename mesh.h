@@ -0,0 +1,97 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <string>
+#include <cstddef>
+
+#include "glm/glm.hpp"
+
+#define GLFW_INCLUDE_GLCOREARB
+#define GL_GLEXT_PROTOTYPES
+#include <GLFW/glfw3.h>
+
+using namespace glm;
+
+//Structs are simply acting as namespaces
+//Access the values like so: VBO::POINTS
+struct VBO{
+	enum {POINTS=0, NORMALS, UVS, INDICES, COUNT};	//PACKED meshes keep everything in POINTS
+};
+
+//How vertices are laid out on the GPU, bits that can be combined
+//	FLOAT			- separate vec3 position, vec3 normal and vec2 uv streams, 32 bytes
+//	PACKED			- one interleaved PackedVertex stream, 16 bytes
+//	DERIVED_NORMALS	- no normals stored at all, the vertex shader uses the
+//					  object space position since every mesh is a unit sphere
+//					  (24 bytes FLOAT, 12 bytes PACKED)
+struct VERTEX_FORMAT{
+	enum {FLOAT=0, PACKED=1, DERIVED_NORMALS=2};
+};
+
+// Quantized vertex for the PACKED format. Positions are snorm16, so they
+// have to lie in [-1, 1], which unit spheres always do. The normal is last
+// so DERIVED_NORMALS meshes can simply stop short of it.
+struct PackedVertex{
+	GLshort position[4];	// snorm16, w is padding
+	GLshort uv[2];			// snorm16, icosphere seams dip a little below u = 0
+	GLshort normal[2];		// octahedral encoded, snorm16
+};
+
+//generateSphere keeps its per mesh sin/cos tables on the stack
+#define MAX_SPHERE_DIVISIONS 1024
+
+//generateIcosphere keys its shared vertices by corner weights, 8 bits each
+#define MAX_ICOSPHERE_FREQUENCY 255
+
+// CPU side copy of a mesh while it's being built. All four arrays are carved
+// out of one block, sized exactly from the vertex and index counts, so a mesh
+// costs a single allocation. The block is kept when a smaller mesh is built
+// into it later, so regenerating meshes at runtime doesn't allocate at all.
+// Start from MeshData data = {}; and give it back with freeMeshData.
+struct MeshData{
+	vec3* points;
+	vec3* normals;
+	vec2* uvs;
+	unsigned int* indices;
+	int vertexCount;
+	int indexCount;
+	unsigned char* block;
+	size_t capacity;	// bytes
+};
+
+// GPU side copy of a mesh. Everything is uploaded once by createMesh and
+// stays put, drawing only needs the VAO bound.
+struct Mesh{
+	GLuint vao;
+	GLuint vbo [VBO::COUNT];
+	GLsizei indexCount;
+	int format;
+};
+
+// One record per drawn body for instanced draws, fed to attributes 3-7.
+// Meshes are unit spheres, the radius is applied in the vertex shader.
+struct Instance{
+	mat4 transform;		// rotation + translation, no scale
+	vec4 params;		// x = radius, y = texture layer, z = 1 if lit
+};
+
+bool allocateMeshData(MeshData& data, int vertexCount, int indexCount);
+void freeMeshData(MeshData& data);
+
+void sphereSize(int divisions, int& vertexCount, int& indexCount);
+void icosphereSize(int frequency, int& vertexCount, int& indexCount);
+
+bool generateSphere(MeshData& data, vec3 center, float radius, int divisions);
+bool generateSphereTrig(MeshData& data, vec3 center, float radius, int divisions);
+bool generateIcosphere(MeshData& data, int frequency);
+
+vec2 octEncode(vec3 n);
+std::string vertexFormatDefines(int format);
+
+bool createMesh(Mesh& mesh, const MeshData& data, int format);
+bool createSphereMesh(Mesh& mesh, float radius, int divisions, int format);
+bool createIcosphereMesh(Mesh& mesh, int frequency, int format);
+void bindInstances(Mesh& mesh, GLuint buffer, GLintptr offset);
+void deleteMesh(Mesh& mesh);
+
+#endif
@@ -0,0 +1,191 @@
+#include "meshopt.h"
+#include <iostream>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+//Runs the indices through a FIFO cache and counts the misses
+CacheStats measureVertexCache(const unsigned int* indices, int indexCount, int vertexCount, int cacheSize)
+{
+	//A vertex is still cached if fewer than cacheSize misses happened since it was loaded
+	vector<int> loadedAt(vertexCount, -cacheSize - 1);
+	int misses = 0;
+
+	for(int i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if(misses - loadedAt[v] > cacheSize)
+		{
+			loadedAt[v] = misses;
+			misses++;
+		}
+	}
+
+	CacheStats stats;
+	stats.acmr = misses / (indexCount / 3.f);
+	stats.atvr = misses / (float)vertexCount;
+	return stats;
+}
+
+//Tipsify (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex
+//Locality and Reduced Overdraw", 2007). Fans out triangles around one vertex
+//at a time, picking the next fan vertex among the ones it just touched that
+//will still be in the cache. Linear in the size of the mesh.
+void optimizeVertexCache(unsigned int* indices, int indexCount, int vertexCount, int cacheSize)
+{
+	int triangleCount = indexCount / 3;
+
+	//Vertex -> triangle adjacency, packed into one array
+	vector<int> live(vertexCount, 0);
+	for(int i = 0; i < indexCount; i++)
+		live[indices[i]]++;
+
+	vector<int> adjacencyStart(vertexCount + 1, 0);
+	for(int v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] = adjacencyStart[v] + live[v];
+
+	vector<int> adjacency(indexCount);
+	vector<int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for(int i = 0; i < indexCount; i++)
+		adjacency[fill[indices[i]]++] = i / 3;
+
+	vector<int> cacheTime(vertexCount, 0);
+	vector<bool> emitted(triangleCount, false);
+	vector<int> deadEnd;
+	vector<int> candidates;
+	vector<unsigned int> output;
+	output.reserve(indexCount);
+
+	int fan = 0;
+	int time = cacheSize + 1;
+	int cursor = 1;
+
+	while(fan >= 0)
+	{
+		candidates.clear();
+
+		for(int a = adjacencyStart[fan]; a < adjacencyStart[fan + 1]; a++)
+		{
+			int t = adjacency[a];
+			if(emitted[t])
+				continue;
+
+			for(int k = 0; k < 3; k++)
+			{
+				unsigned int v = indices[t*3 + k];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+
+				if(time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+
+			emitted[t] = true;
+		}
+
+		//Prefer the candidate that's been in the cache longest but will still
+		//be there after its remaining triangles are emitted
+		int next = -1;
+		int best = -1;
+		for(unsigned int c = 0; c < candidates.size(); c++)
+		{
+			int v = candidates[c];
+			if(live[v] <= 0)
+				continue;
+
+			int priority = 0;
+			if(time - cacheTime[v] + 2*live[v] <= cacheSize)
+				priority = time - cacheTime[v];
+
+			if(priority > best)
+			{
+				best = priority;
+				next = v;
+			}
+		}
+
+		//Dead end, back up through recently used vertices, then just scan
+		while(next < 0 && !deadEnd.empty())
+		{
+			int v = deadEnd.back();
+			deadEnd.pop_back();
+			if(live[v] > 0)
+				next = v;
+		}
+
+		while(next < 0 && cursor < vertexCount)
+		{
+			if(live[cursor] > 0)
+				next = cursor;
+			cursor++;
+		}
+
+		fan = next;
+	}
+
+	copy(output.begin(), output.end(), indices);
+}
+
+//Renumbers vertices in the order the index buffer first uses them, so vertex
+//fetches walk through memory instead of jumping between sphere rings.
+//Vertices no triangle uses are dropped. The result is built in scratch and
+//the two are swapped, so data keeps the mesh and scratch the old memory.
+bool optimizeVertexFetch(MeshData& data, MeshData& scratch)
+{
+	if(!allocateMeshData(scratch, data.vertexCount, data.indexCount))
+		return false;
+
+	vector<int> remap(data.vertexCount, -1);
+	int vertexCount = 0;
+
+	for(int i = 0; i < data.indexCount; i++)
+	{
+		unsigned int v = data.indices[i];
+		if(remap[v] < 0)
+		{
+			remap[v] = vertexCount;
+			scratch.points[vertexCount] = data.points[v];
+			scratch.normals[vertexCount] = data.normals[v];
+			scratch.uvs[vertexCount] = data.uvs[v];
+			vertexCount++;
+		}
+
+		scratch.indices[i] = remap[v];
+	}
+
+	scratch.vertexCount = vertexCount;
+	swap(data, scratch);
+	return true;
+}
+
+//Reorders triangles then vertices, printing the cache stats before and after
+bool optimizeMesh(MeshData& data, MeshData& scratch, const char* name)
+{
+	CacheStats before = measureVertexCache(data.indices, data.indexCount, data.vertexCount, VERTEX_CACHE_SIZE);
+
+	//Tiny meshes can already fit the cache better than Tipsify manages, so
+	//try it on a copy first
+	if(!allocateMeshData(scratch, data.vertexCount, data.indexCount))
+		return false;
+
+	copy(data.indices, data.indices + data.indexCount, scratch.indices);
+	optimizeVertexCache(scratch.indices, data.indexCount, data.vertexCount, VERTEX_CACHE_SIZE);
+	if(measureVertexCache(scratch.indices, data.indexCount, data.vertexCount, VERTEX_CACHE_SIZE).acmr < before.acmr)
+		copy(scratch.indices, scratch.indices + data.indexCount, data.indices);
+
+	if(!optimizeVertexFetch(data, scratch))
+		return false;
+
+	CacheStats after = measureVertexCache(data.indices, data.indexCount, data.vertexCount, VERTEX_CACHE_SIZE);
+
+	char line[256];
+	snprintf(line, sizeof(line), "%s: ACMR %.3f -> %.3f  ATVR %.3f -> %.3f",
+			name, before.acmr, after.acmr, before.atvr, after.atvr);
+	cout << line << endl;
+
+	return true;
+}
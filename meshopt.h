@@ -0,0 +1,25 @@
+#ifndef MESHOPT_H
+#define MESHOPT_H
+
+#include "mesh.h"
+
+//Size of the FIFO post-transform cache we optimize for and report against.
+//Real hardware varies, 16 is a safe lower bound.
+#define VERTEX_CACHE_SIZE 16
+
+//How well an index buffer uses the post-transform cache
+//	ACMR - vertices transformed per triangle, 0.5 is the best a grid can do
+//	ATVR - vertices transformed per unique vertex, 1.0 is perfect
+struct CacheStats{
+	float acmr;
+	float atvr;
+};
+
+CacheStats measureVertexCache(const unsigned int* indices, int indexCount, int vertexCount, int cacheSize);
+
+void optimizeVertexCache(unsigned int* indices, int indexCount, int vertexCount, int cacheSize);
+bool optimizeVertexFetch(MeshData& data, MeshData& scratch);
+
+bool optimizeMesh(MeshData& data, MeshData& scratch, const char* name);
+
+#endif
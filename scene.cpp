@@ -0,0 +1,60 @@
+#include "scene.h"
+
+//Parents have to be added first, so a node can only be hung under an
+//existing one. Returns the new node's index.
+int addNode(SceneGraph& scene, int parent, vec3 position, quat rotation)
+{
+	if(parent >= nodeCount(scene))
+		return -1;
+
+	scene.parent.push_back(parent);
+	scene.localPosition.push_back(position);
+	scene.localRotation.push_back(rotation);
+	scene.worldPosition.push_back(position);
+	scene.dirty.push_back(1);
+	scene.movedIn.push_back(0);
+
+	return nodeCount(scene) - 1;
+}
+
+int nodeCount(const SceneGraph& scene)
+{
+	return scene.parent.size();
+}
+
+//Only marks the node dirty if something actually changed, so a paused
+//scene costs nothing to update
+void setLocalTransform(SceneGraph& scene, int node, vec3 position, quat rotation)
+{
+	if(scene.localPosition[node] == position && scene.localRotation[node] == rotation)
+		return;
+
+	scene.localPosition[node] = position;
+	scene.localRotation[node] = rotation;
+	scene.dirty[node] = 1;
+}
+
+//One pass front to back. A node needs redoing if it's dirty itself or its
+//parent moved during this same update. Returns how many nodes were redone.
+int updateWorldTransforms(SceneGraph& scene)
+{
+	unsigned int update = ++scene.update;
+	int count = nodeCount(scene);
+	int moved = 0;
+
+	for(int i = 0; i < count; i++)
+	{
+		int parent = scene.parent[i];
+		bool parentMoved = parent >= 0 && scene.movedIn[parent] == update;
+		if(!scene.dirty[i] && !parentMoved)
+			continue;
+
+		vec3 parentPosition = parent >= 0 ? scene.worldPosition[parent] : vec3(0.0);
+		scene.worldPosition[i] = parentPosition + scene.localPosition[i];
+		scene.dirty[i] = 0;
+		scene.movedIn[i] = update;
+		moved++;
+	}
+
+	return moved;
+}
@@ -0,0 +1,37 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+using namespace glm;
+
+// A flat scene graph. Every node is an index into parallel arrays, and a
+// node's parent always comes before it, so one front to back pass updates
+// the whole tree with parents ready before their children.
+//
+// Children inherit their parent's position but not its rotation: a moon
+// goes round in a fixed frame centered on its planet, not the planet's
+// spinning one.
+//
+// Only nodes whose local transform changed, and everything under them, get
+// their world position redone by updateWorldTransforms.
+struct SceneGraph{
+	std::vector<int> parent;				// -1 for roots
+	std::vector<vec3> localPosition;		// relative to the parent's world position
+	std::vector<quat> localRotation;		// also the world rotation, see above
+	std::vector<vec3> worldPosition;		// what snapshots record, matrices get built after interpolating
+	std::vector<unsigned char> dirty;		// local transform changed since the last update
+	std::vector<unsigned int> movedIn;		// the last update that changed the world transform
+	unsigned int update = 0;				// count of updateWorldTransforms calls
+};
+
+int addNode(SceneGraph& scene, int parent, vec3 position, quat rotation);
+int nodeCount(const SceneGraph& scene);
+
+void setLocalTransform(SceneGraph& scene, int node, vec3 position, quat rotation);
+int updateWorldTransforms(SceneGraph& scene);
+
+#endif
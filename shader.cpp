@@ -0,0 +1,119 @@
+#include "shader.h"
+#include <iostream>
+#include <cstring>
+
+using namespace std;
+
+std::string LoadSource(const string &filename);
+GLuint CompileShader(GLenum shaderType, const string &source);
+GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader);
+bool CheckGLErrors(string location);
+
+// names and types as declared in the glsl, indexed by UNIFORM
+static const struct { const char* name; GLenum type; } uniformInfo [UNIFORM::COUNT] = {
+	{"texBodies",			GL_SAMPLER_2D_ARRAY},
+};
+
+// walks the program's active uniforms and fills in the handle table
+static void resolveUniforms(ShaderProgram& program)
+{
+	for(int i = 0; i < UNIFORM::COUNT; i++)
+		program.uniforms[i] = -1;
+
+	GLint count = 0;
+	glGetProgramiv(program.id, GL_ACTIVE_UNIFORMS, &count);
+
+	for(GLint i = 0; i < count; i++)
+	{
+		char name[256];
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(program.id, i, sizeof(name), 0, &size, &type, name);
+
+		//Arrays are reported as "name[0]", the table just has "name"
+		char* bracket = strchr(name, '[');
+		if(bracket)
+			*bracket = '\0';
+
+		for(int j = 0; j < UNIFORM::COUNT; j++)
+		{
+			if(string(name) != uniformInfo[j].name)
+				continue;
+
+			if(type != uniformInfo[j].type)
+				cout << "ERROR: uniform " << name << " has an unexpected type" << endl;
+			else
+				program.uniforms[j] = glGetUniformLocation(program.id, name);
+		}
+	}
+}
+
+// #defines have to come after #version, so slot them in on the next line
+static string addDefines(const string& source, const string& defines)
+{
+	size_t version = source.find("#version");
+	if(version == string::npos || defines.empty())
+		return source;
+
+	size_t line = source.find('\n', version);
+	if(line == string::npos)
+		return source + "\n" + defines;
+
+	return source.substr(0, line + 1) + defines + source.substr(line + 1);
+}
+
+//Compile and link shaders, then look up every uniform the program uses.
+//defines get added to both sources, e.g. "#define PACKED_NORMALS\n"
+bool createShaderProgram(ShaderProgram& program, const string& vertexFile, const string& fragmentFile,
+						const string& defines)
+{
+	string vertexSource = addDefines(LoadSource(vertexFile), defines);		//Put vertex file text into string
+	string fragmentSource = addDefines(LoadSource(fragmentFile), defines);		//Put fragment file text into string
+
+	GLuint vertexID = CompileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragmentID = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+
+	program.id = LinkProgram(vertexID, fragmentID);
+
+	//The program keeps what it needs, the shader objects can go
+	glDeleteShader(vertexID);
+	glDeleteShader(fragmentID);
+
+	resolveUniforms(program);
+
+	//Hook the frame block up to its binding point, if the program has it
+	GLuint frameBlock = glGetUniformBlockIndex(program.id, "FrameData");
+	if(frameBlock != GL_INVALID_INDEX)
+		glUniformBlockBinding(program.id, frameBlock, UBO::FRAME);
+
+	//The texture array lives on unit 0 for good, so set the sampler once here
+	glUseProgram(program.id);
+	glUniform1i(program.uniforms[UNIFORM::TEX_BODIES], 0);
+	glUseProgram(0);
+
+	return !CheckGLErrors("createShaderProgram");
+}
+
+void deleteShaderProgram(ShaderProgram& program)
+{
+	glDeleteProgram(program.id);
+}
+
+//Streams this frame's constants and binds them to the FrameData block
+bool loadFrameData(StreamBuffer& stream, const FrameData& data)
+{
+	static GLint alignment = 0;
+	if(!alignment)
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+	GLintptr offset = streamData(stream, &data, sizeof(FrameData), alignment);
+	if(offset < 0)
+	{
+		cout << "ERROR: no room left to stream frame data" << endl;
+		return false;
+	}
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, UBO::FRAME, stream.buffer, offset, sizeof(FrameData));
+
+	return !CheckGLErrors("loadFrameData");
+}
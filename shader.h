@@ -0,0 +1,49 @@
+#ifndef SHADER_H
+#define SHADER_H
+
+#include <string>
+
+#include "glm/glm.hpp"
+
+#define GLFW_INCLUDE_GLCOREARB
+#define GL_GLEXT_PROTOTYPES
+#include <GLFW/glfw3.h>
+
+#include "stream.h"
+
+//Every uniform any of our programs might use
+//Access the values like so: UNIFORM::TEX_BODIES
+struct UNIFORM{
+	enum {TEX_BODIES=0, COUNT};
+};
+
+//Binding points for uniform blocks, shared by every program
+struct UBO{
+	enum {FRAME=0, COUNT};
+};
+
+// Everything that stays the same for all draws in a frame. Laid out to match
+// the std140 FrameData block in vertex.glsl and fragment.glsl, so only
+// add vec4/mat4 sized members (or pad to them).
+struct FrameData{
+	glm::mat4 cameraMatrix;
+	glm::mat4 perspectiveMatrix;
+	glm::vec4 lightPosition;		// xyz in world space
+	glm::vec4 time;					// x = seconds since startup, y/z = simulation time wrapped for orbits/spins
+};
+
+// A linked program plus the locations of its uniforms, looked up once right
+// after linking so nothing has to call glGetUniformLocation while drawing.
+// Uniforms the program doesn't use are left at -1, which GL quietly ignores.
+struct ShaderProgram{
+	GLuint id;
+	GLint uniforms [UNIFORM::COUNT];
+};
+
+bool createShaderProgram(ShaderProgram& program, const std::string& vertexFile, const std::string& fragmentFile,
+						const std::string& defines = "");
+void deleteShaderProgram(ShaderProgram& program);
+
+bool loadFrameData(StreamBuffer& stream, const FrameData& data);
+
+#endif
@@ -0,0 +1,148 @@
+#include "stream.h"
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+bool CheckGLErrors(string location);
+bool hasGLExtension(const char* name);
+
+#define STREAM_FLAGS (GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+// glBufferStorage isn't part of 4.1, so look it up rather than linking to it
+static PFNGLBUFFERSTORAGEPROC bufferStorage()
+{
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	bool supported = major > 4 || (major == 4 && minor >= 4);
+
+	if(!supported && !hasGLExtension("GL_ARB_buffer_storage"))
+		return 0;
+	return (PFNGLBUFFERSTORAGEPROC)glfwGetProcAddress("glBufferStorage");
+}
+
+//Allocates all STREAM_FRAMES regions, and maps them if the storage can stay mapped
+bool createStreamBuffer(StreamBuffer& stream, GLsizeiptr frameSize, bool allowPersistent)
+{
+	stream = StreamBuffer();
+	stream.frameSize = frameSize;
+
+	glGenBuffers(1, &stream.buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+
+	PFNGLBUFFERSTORAGEPROC storage = allowPersistent ? bufferStorage() : 0;
+	if(storage)
+	{
+		storage(GL_COPY_WRITE_BUFFER, frameSize * STREAM_FRAMES, 0, STREAM_FLAGS);
+		stream.mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, frameSize * STREAM_FRAMES, STREAM_FLAGS);
+		stream.persistent = stream.mapped != 0;
+	}
+
+	//Without it, a plain buffer that gets mapped a range at a time
+	if(!stream.persistent)
+	{
+		if(storage)
+		{
+			glDeleteBuffers(1, &stream.buffer);		//Immutable now, so start over
+			glGenBuffers(1, &stream.buffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+		}
+		glBufferData(GL_COPY_WRITE_BUFFER, frameSize * STREAM_FRAMES, 0, GL_STREAM_DRAW);
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	return !CheckGLErrors("createStreamBuffer");
+}
+
+//Reserves size bytes in this frame's region and returns where to write them,
+//or null if the region is full. offset is where they'll be in the buffer.
+//Every map has to be followed by unmapStream before anything draws.
+void* mapStream(StreamBuffer& stream, GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset)
+{
+	GLsizeiptr start = ((stream.used + alignment - 1) / alignment) * alignment;
+	if(start + size > stream.frameSize)
+	{
+		offset = -1;
+		return 0;
+	}
+
+	stream.used = start + size;
+	stream.bytesThisFrame += size;
+	offset = stream.frame * stream.frameSize + start;
+
+	if(stream.persistent)
+		return stream.mapped + offset;
+
+	//endStreamFrame already waited for the GPU to finish with this region
+	glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+	return glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size,
+					GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+void unmapStream(StreamBuffer& stream)
+{
+	if(stream.persistent)
+		return;		//Coherent, the GPU sees the writes without any flushing
+
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+//Copies data into this frame's region, returns its offset or -1 if there wasn't room
+GLintptr streamData(StreamBuffer& stream, const void* data, GLsizeiptr size, GLsizeiptr alignment)
+{
+	GLintptr offset;
+	void* dst = mapStream(stream, size, alignment, offset);
+	if(!dst)
+		return -1;
+
+	memcpy(dst, data, size);
+	unmapStream(stream);
+	return offset;
+}
+
+//Call once all of this frame's draws are issued, before swapping. Moves on to
+//the next region, waiting first if the GPU could still be reading it.
+void endStreamFrame(StreamBuffer& stream)
+{
+	//Both modes write without the driver syncing, so both wait on the fence
+	stream.fences[stream.frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	stream.frame = (stream.frame + 1) % STREAM_FRAMES;
+	stream.used = 0;
+	stream.bytesLastFrame = stream.bytesThisFrame;
+	stream.bytesThisFrame = 0;
+
+	GLsync& fence = stream.fences[stream.frame];
+	if(fence)
+	{
+		//Usually long signalled. If not, flush so the wait can't hang.
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if(result == GL_TIMEOUT_EXPIRED)
+		{
+			stream.stalls++;
+			while(result == GL_TIMEOUT_EXPIRED)
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		}
+		glDeleteSync(fence);
+		fence = 0;
+	}
+}
+
+void deleteStreamBuffer(StreamBuffer& stream)
+{
+	for(int i = 0; i < STREAM_FRAMES; i++)
+		if(stream.fences[i])
+			glDeleteSync(stream.fences[i]);
+
+	if(stream.persistent)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	glDeleteBuffers(1, &stream.buffer);
+}
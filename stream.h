@@ -0,0 +1,40 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <cstddef>
+
+#define GLFW_INCLUDE_GLCOREARB
+#define GL_GLEXT_PROTOTYPES
+#include <GLFW/glfw3.h>
+
+#define STREAM_FRAMES 3
+
+// One buffer for everything that gets rewritten every frame, split into
+// STREAM_FRAMES regions. Each frame appends to its own region while the GPU
+// is still drawing from the other two.
+//
+// With GL 4.4 or ARB_buffer_storage the whole buffer stays mapped for good.
+// On plain 4.1 each write maps just its range, unsynchronized. Either way a
+// fence per region is the only thing that says when the GPU is done with it.
+struct StreamBuffer{
+	GLuint buffer;
+	GLsizeiptr frameSize;		// bytes in each region
+	unsigned char* mapped;		// whole buffer, persistent mode only
+	GLsync fences [STREAM_FRAMES];
+	int frame;					// region being filled
+	GLsizeiptr used;			// bytes of it filled so far
+	bool persistent;
+
+	size_t bytesThisFrame;
+	size_t bytesLastFrame;		// for reporting, this frame isn't finished yet
+	int stalls;					// frames that had to wait on a fence, ever
+};
+
+bool createStreamBuffer(StreamBuffer& stream, GLsizeiptr frameSize, bool allowPersistent = true);
+void* mapStream(StreamBuffer& stream, GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset);
+void unmapStream(StreamBuffer& stream);
+GLintptr streamData(StreamBuffer& stream, const void* data, GLsizeiptr size, GLsizeiptr alignment);
+void endStreamFrame(StreamBuffer& stream);
+void deleteStreamBuffer(StreamBuffer& stream);
+
+#endif
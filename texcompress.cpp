@@ -0,0 +1,222 @@
+#include "texcompress.h"
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+
+using namespace glm;
+
+const char* textureFormatName(int format)
+{
+	static const char* names [TEXTURE_FORMAT::COUNT] = {"raw", "BC1"};
+	return names[format];
+}
+
+//Bytes for one mip level of the given size
+size_t levelSize(int width, int height, int components, int format)
+{
+	if(format == TEXTURE_FORMAT::BC1)
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 8;
+	return (size_t)width * height * components;
+}
+
+static unsigned short packColor(vec3 color)
+{
+	color = clamp(color, 0.f, 255.f);
+	int r = (int)(color.r * 31.f / 255.f + 0.5f);
+	int g = (int)(color.g * 63.f / 255.f + 0.5f);
+	int b = (int)(color.b * 31.f / 255.f + 0.5f);
+	return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+static void unpackColor(unsigned short packed, int* color)
+{
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+//The four colours a BC1 block can pick from, when color0 > color1
+static void colorPalette(unsigned short color0, unsigned short color1, int palette [4][3])
+{
+	unpackColor(color0, palette[0]);
+	unpackColor(color1, palette[1]);
+	for(int k = 0; k < 3; k++)
+	{
+		palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+		palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+	}
+}
+
+//8 byte block for 16 RGB(A) pixels, components apart
+static void encodeColorBlock(const unsigned char* block, int components, unsigned char* out)
+{
+	vec3 colors [16];
+	vec3 mean(0.f);
+	for(int i = 0; i < 16; i++)
+	{
+		colors[i] = vec3(block[i * components], block[i * components + 1], block[i * components + 2]);
+		mean += colors[i];
+	}
+	mean /= 16.f;
+
+	//Principal axis of the covariance, by a few rounds of power iteration
+	mat3 covariance(0.f);
+	for(int i = 0; i < 16; i++)
+	{
+		vec3 d = colors[i] - mean;
+		covariance += outerProduct(d, d);
+	}
+
+	vec3 axis(1.f);
+	for(int i = 0; i < 4; i++)
+	{
+		axis = covariance * axis;
+		float largest = std::max(std::max(fabsf(axis.x), fabsf(axis.y)), fabsf(axis.z));
+		if(largest < 1e-6f)
+			break;
+		axis /= largest;
+	}
+
+	float low = 0.f, high = 0.f;
+	if(dot(axis, axis) > 1e-12f)
+	{
+		axis = normalize(axis);
+		low = high = dot(colors[0] - mean, axis);
+		for(int i = 1; i < 16; i++)
+		{
+			float t = dot(colors[i] - mean, axis);
+			low = std::min(low, t);
+			high = std::max(high, t);
+		}
+
+		//Pull the ends in a little, the extremes are rarely worth an endpoint each
+		float inset = (high - low) / 16.f;
+		low += inset;
+		high -= inset;
+	}
+
+	unsigned short color0 = packColor(mean + axis * high);
+	unsigned short color1 = packColor(mean + axis * low);
+	if(color0 < color1)
+		std::swap(color0, color1);
+
+	unsigned int indices = 0;
+	if(color0 != color1)
+	{
+		int palette [4][3];
+		colorPalette(color0, color1, palette);
+
+		for(int i = 0; i < 16; i++)
+		{
+			int best = 0, bestError = 1 << 30;
+			for(int j = 0; j < 4; j++)
+			{
+				int dr = palette[j][0] - block[i * components];
+				int dg = palette[j][1] - block[i * components + 1];
+				int db = palette[j][2] - block[i * components + 2];
+				int error = dr * dr + dg * dg + db * db;
+				if(error < bestError)
+				{
+					best = j;
+					bestError = error;
+				}
+			}
+			indices |= best << (2 * i);
+		}
+	}
+
+	out[0] = color0 & 255;
+	out[1] = color0 >> 8;
+	out[2] = color1 & 255;
+	out[3] = color1 >> 8;
+	for(int i = 0; i < 4; i++)
+		out[4 + i] = (indices >> (8 * i)) & 255;
+}
+
+static void decodeColorBlock(const unsigned char* in, int components, unsigned char* block)
+{
+	unsigned short color0 = in[0] | (in[1] << 8);
+	unsigned short color1 = in[2] | (in[3] << 8);
+	unsigned int indices = in[4] | (in[5] << 8) | (in[6] << 16) | ((unsigned int)in[7] << 24);
+
+	//Blocks with color0 <= color1 are in the 3 colour + black mode, which
+	//the encoder never writes unless both ends are the same
+	int palette [4][3];
+	colorPalette(color0, color1, palette);
+	if(color0 <= color1)
+	{
+		for(int k = 0; k < 3; k++)
+		{
+			palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+			palette[3][k] = 0;
+		}
+	}
+
+	for(int i = 0; i < 16; i++)
+		for(int k = 0; k < 3; k++)
+			block[i * components + k] = palette[(indices >> (2 * i)) & 3][k];
+}
+
+void compressImage(const unsigned char* pixels, int width, int height, int components, unsigned char* blocks)
+{
+	unsigned char block [16 * 4];
+
+	for(int by = 0; by < height; by += 4)
+	{
+		for(int bx = 0; bx < width; bx += 4)
+		{
+			for(int i = 0; i < 16; i++)
+			{
+				int x = std::min(bx + i % 4, width - 1);
+				int y = std::min(by + i / 4, height - 1);
+				memcpy(block + i * components, pixels + ((size_t)y * width + x) * components, components);
+			}
+
+			encodeColorBlock(block, components, blocks);
+			blocks += 8;
+		}
+	}
+}
+
+//Back to components channels per pixel, alpha comes out opaque
+void decompressImage(const unsigned char* blocks, int width, int height, int components, unsigned char* pixels)
+{
+	unsigned char block [16 * 4];
+	memset(block, 255, sizeof(block));
+
+	for(int by = 0; by < height; by += 4)
+	{
+		for(int bx = 0; bx < width; bx += 4)
+		{
+			decodeColorBlock(blocks, 4, block);
+
+			for(int i = 0; i < 16; i++)
+			{
+				int x = bx + i % 4, y = by + i / 4;
+				if(x < width && y < height)
+					memcpy(pixels + ((size_t)y * width + x) * components, block + i * 4, components);
+			}
+
+			blocks += 8;
+		}
+	}
+}
+
+//Over every byte of both, capped at 99 dB for identical images
+double imagePSNR(const unsigned char* a, const unsigned char* b, size_t count)
+{
+	double error = 0.0;
+	for(size_t i = 0; i < count; i++)
+	{
+		double d = (double)a[i] - b[i];
+		error += d * d;
+	}
+
+	if(error == 0.0)
+		return 99.0;
+	return std::min(10.0 * log10(255.0 * 255.0 * count / error), 99.0);
+}
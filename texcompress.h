@@ -0,0 +1,26 @@
+#ifndef TEXCOMPRESS_H
+#define TEXCOMPRESS_H
+
+#include <cstddef>
+
+//How a texture's texels are stored, in memory, in the cache and on the GPU
+//Access the values like so: TEXTURE_FORMAT::BC1
+struct TEXTURE_FORMAT{
+	enum {RAW=0,	// 8 bits per channel, 3 or 4 channels
+		BC1,		// aka DXT1, 4x4 RGB blocks in 8 bytes
+		COUNT};
+};
+
+const char* textureFormatName(int format);
+size_t levelSize(int width, int height, int components, int format);
+
+// Compresses a whole image to BC1, blocks hanging off the right or bottom edge
+// repeat the last row/column. The encoder fits each block's endpoints along
+// the principal axis of its colours, which is quick and usually within a few
+// dB of an exhaustive search.
+void compressImage(const unsigned char* pixels, int width, int height, int components, unsigned char* blocks);
+void decompressImage(const unsigned char* blocks, int width, int height, int components, unsigned char* pixels);
+
+double imagePSNR(const unsigned char* a, const unsigned char* b, size_t count);
+
+#endif
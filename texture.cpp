@@ -0,0 +1,650 @@
+#include "texture.h"
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "stb_image.h"
+
+using namespace std;
+
+bool CheckGLErrors(string location);
+bool hasGLExtension(const char* name);
+
+//Same values as the EXT/ARB extensions, older headers only have them there
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+#ifndef GL_TEXTURE_MAX_ANISOTROPY
+#define GL_TEXTURE_MAX_ANISOTROPY 0x84FE
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY 0x84FF
+#endif
+
+static double seconds()
+{
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Halving each time down to 1x1, the same way GL counts them
+int mipLevels(int width, int height)
+{
+	int levels = 1;
+	while(width > 1 || height > 1)
+	{
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		levels++;
+	}
+	return levels;
+}
+
+size_t mipChainSize(int width, int height, int components, int levels, int format)
+{
+	size_t size = 0;
+	for(int i = 0; i < levels; i++)
+	{
+		size += levelSize(width, height, components, format);
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	return size;
+}
+
+//Adds two rows of bytes into 16 bit sums, 16 at a time where there's SSE2
+static void addRows(const unsigned char* a, const unsigned char* b, unsigned short* sums, int count)
+{
+	int i = 0;
+#ifdef __SSE2__
+	__m128i zero = _mm_setzero_si128();
+	for(; i + 16 <= count; i += 16)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+		__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(y, zero));
+		__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(y, zero));
+		_mm_storeu_si128((__m128i*)(sums + i), low);
+		_mm_storeu_si128((__m128i*)(sums + i + 8), high);
+	}
+#endif
+	for(; i < count; i++)
+		sums[i] = a[i] + b[i];
+}
+
+//Box filters one level into the next, each pixel the rounded average of a
+//2x2 block. Rows are summed in pairs first, then neighbouring pixels in the
+//sums. An odd last row or column gets dropped, a level one pixel across
+//averages with itself.
+static void downsample(const unsigned char* src, int width, int height, unsigned char* dst, int components,
+						vector<unsigned short>& sums)
+{
+	int nextWidth = std::max(width / 2, 1);
+	int nextHeight = std::max(height / 2, 1);
+	int row = width * components;
+	sums.resize(row);
+
+	for(int y = 0; y < nextHeight; y++)
+	{
+		const unsigned char* top = src + (size_t)std::min(2 * y, height - 1) * row;
+		const unsigned char* bottom = src + (size_t)std::min(2 * y + 1, height - 1) * row;
+		addRows(top, bottom, sums.data(), row);
+
+		unsigned char* out = dst + (size_t)y * nextWidth * components;
+		for(int x = 0; x < nextWidth; x++)
+		{
+			const unsigned short* left = &sums[2 * x * components];
+			const unsigned short* right = &sums[std::min(2 * x + 1, width - 1) * components];
+			for(int k = 0; k < components; k++)
+				out[x * components + k] = (left[k] + right[k] + 2) >> 2;
+		}
+	}
+}
+
+//pixels has to have room for the whole chain, with the top level filled in
+void generateMipmaps(unsigned char* pixels, int width, int height, int components, int levels)
+{
+	vector<unsigned short> sums;
+	for(int i = 1; i < levels; i++)
+	{
+		unsigned char* next = pixels + (size_t)width * height * components;
+		downsample(pixels, width, height, next, components, sums);
+
+		pixels = next;
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+}
+
+//Scales an image to nextWidth x nextHeight by bilinear filtering, with the
+//pixel centres lined up and the edges clamped. Only good for stretching, or
+//shrinking by less than half, past that it starts skipping pixels.
+static void resample(const unsigned char* src, int width, int height, unsigned char* dst, int nextWidth, int nextHeight,
+						int components)
+{
+	float scaleX = (float)width / nextWidth;
+	float scaleY = (float)height / nextHeight;
+
+	for(int y = 0; y < nextHeight; y++)
+	{
+		float fy = clamp((y + 0.5f) * scaleY - 0.5f, 0.f, (float)(height - 1));
+		int y0 = (int)fy, y1 = std::min(y0 + 1, height - 1);
+		float ty = fy - y0;
+
+		const unsigned char* top = src + (size_t)y0 * width * components;
+		const unsigned char* bottom = src + (size_t)y1 * width * components;
+		unsigned char* out = dst + (size_t)y * nextWidth * components;
+
+		for(int x = 0; x < nextWidth; x++)
+		{
+			float fx = clamp((x + 0.5f) * scaleX - 0.5f, 0.f, (float)(width - 1));
+			int x0 = (int)fx, x1 = std::min(x0 + 1, width - 1);
+			float tx = fx - x0;
+
+			for(int k = 0; k < components; k++)
+			{
+				float upper = mix((float)top[x0 * components + k], (float)top[x1 * components + k], tx);
+				float lower = mix((float)bottom[x0 * components + k], (float)bottom[x1 * components + k], tx);
+				out[x * components + k] = (unsigned char)(mix(upper, lower, ty) + 0.5f);
+			}
+		}
+	}
+}
+
+//One level of one layer, texels already in the array's format
+static void uploadLevel(TextureArray& array, int layer, int level, int width, int height, const unsigned char* texels)
+{
+	if(array.format == TEXTURE_FORMAT::BC1)
+		glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+								levelSize(width, height, TEXTURE_COMPONENTS, array.format), texels);
+	else
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, GL_RGB, GL_UNSIGNED_BYTE, texels);
+}
+
+//For reference:
+//	https://www.khronos.org/opengl/wiki/Array_Texture
+//Room for every level of every layer, which hold nothing useful until they're
+//filled in. BC1 if asked for and the driver can take it, otherwise RGB8.
+bool createTextureArray(TextureArray& array, int layers, int width, int height, bool compress)
+{
+	array = TextureArray();
+	array.width = width;
+	array.height = height;
+	array.layers = layers;
+	array.levels = mipLevels(width, height);
+	array.format = compress && hasGLExtension("GL_EXT_texture_compression_s3tc") ? TEXTURE_FORMAT::BC1 : TEXTURE_FORMAT::RAW;
+
+	glGenTextures(1, &array.id);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+
+	//No glTexStorage before 4.2, so each level gets allocated on its own
+	for(int i = 0; i < array.levels; i++)
+	{
+		if(array.format == TEXTURE_FORMAT::BC1)
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, i, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, width, height, layers, 0,
+								levelSize(width, height, TEXTURE_COMPONENTS, array.format) * layers, 0);
+		else
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, i, GL_RGB8, width, height, layers, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
+
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, array.levels - 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	setTextureFilter(array, TEXTURE_FILTER::ANISOTROPIC);
+
+	return !CheckGLErrors("createTextureArray");
+}
+
+//One colour over the whole layer, something to draw with until the image is in
+void fillTextureLayer(TextureArray& array, int layer, vec3 color)
+{
+	unsigned char pixels [16 * TEXTURE_COMPONENTS];
+	for(int i = 0; i < 16 * TEXTURE_COMPONENTS; i++)
+		pixels[i] = (unsigned char)(clamp(color[i % TEXTURE_COMPONENTS], 0.f, 1.f) * 255.f);
+
+	//A 4x4 block of it, then the top level's worth of those. Smaller levels
+	//only use the start, every block's the same.
+	size_t blockSize = levelSize(4, 4, TEXTURE_COMPONENTS, array.format);
+	unsigned char block [16 * TEXTURE_COMPONENTS];
+	if(array.format == TEXTURE_FORMAT::RAW)
+		memcpy(block, pixels, blockSize);
+	else
+		compressImage(pixels, 4, 4, TEXTURE_COMPONENTS, block);
+
+	vector<unsigned char> texels(levelSize(array.width, array.height, TEXTURE_COMPONENTS, array.format));
+	for(size_t i = 0; i + blockSize <= texels.size(); i += blockSize)
+		memcpy(&texels[i], block, blockSize);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);		//RGB rows aren't always 4 byte aligned
+
+	int width = array.width, height = array.height;
+	for(int i = 0; i < array.levels; i++)
+	{
+		uploadLevel(array, layer, i, width, height, texels.data());
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+//Replaces a layer with an image the array's size. pixels holds the whole mip
+//chain in format, biggest first. Anything in a different format to the array
+//gets converted here, usually BC1 expanded for a driver that can't take it.
+bool uploadTextureLayer(TextureArray& array, int layer, const unsigned char* pixels, int format)
+{
+	vector<unsigned char> expanded;
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	int width = array.width, height = array.height;
+	for(int i = 0; i < array.levels; i++)
+	{
+		const unsigned char* texels = pixels;
+		if(format != array.format)
+		{
+			expanded.resize(levelSize(width, height, TEXTURE_COMPONENTS, array.format));
+			if(format == TEXTURE_FORMAT::RAW)
+				compressImage(pixels, width, height, TEXTURE_COMPONENTS, expanded.data());
+			else
+				decompressImage(pixels, width, height, TEXTURE_COMPONENTS, expanded.data());
+			texels = expanded.data();
+		}
+		uploadLevel(array, layer, i, width, height, texels);
+
+		pixels += levelSize(width, height, TEXTURE_COMPONENTS, format);
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	return !CheckGLErrors("uploadTextureLayer");
+}
+
+//Anisotropic falls back to plain trilinear where the extension's missing
+void setTextureFilter(TextureArray& array, int filter)
+{
+	static float maxAnisotropy = -1.f;
+	if(maxAnisotropy < 0.f)
+	{
+		maxAnisotropy = 0.f;
+		if(hasGLExtension("GL_EXT_texture_filter_anisotropic") || hasGLExtension("GL_ARB_texture_filter_anisotropic"))
+			glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &maxAnisotropy);
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, filter == TEXTURE_FILTER::BILINEAR ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if(maxAnisotropy > 0.f)
+		glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY,
+						filter == TEXTURE_FILTER::ANISOTROPIC ? std::min(maxAnisotropy, MAX_ANISOTROPY) : 1.f);
+}
+
+const char* textureFilterName(int filter)
+{
+	static const char* names [TEXTURE_FILTER::COUNT] = {"bilinear", "trilinear", "anisotropic"};
+	return names[filter];
+}
+
+void deleteTextureArray(TextureArray& array)
+{
+	glDeleteTextures(1, &array.id);
+	array.id = 0;
+}
+
+static uint64_t fnv1a(const unsigned char* bytes, size_t size)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for(size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	return hash;
+}
+
+static bool readFile(const string& filename, vector<unsigned char>& bytes)
+{
+	FILE* file = fopen(filename.c_str(), "rb");
+	if(!file)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	bytes.resize(std::max(size, 0L));
+	bool ok = size >= 0 && fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+	fclose(file);
+	return ok;
+}
+
+static string cachePath(const string& filename)
+{
+	return filename + ".texcache";
+}
+
+//Points load.pixels straight at the cached texels, if there's a cache file
+//that matches the source and is in the size and format asked for
+static bool mapCache(TextureLoad& load, const TextureLoader& loader, uint64_t sourceHash, uint64_t sourceSize)
+{
+	int file = open(cachePath(load.filename).c_str(), O_RDONLY);
+	if(file < 0)
+		return false;
+
+	struct stat info;
+	void* mapping = MAP_FAILED;
+	if(fstat(file, &info) == 0 && (size_t)info.st_size >= sizeof(TextureCacheHeader))
+		mapping = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);		//The mapping keeps its own reference
+
+	if(mapping == MAP_FAILED)
+		return false;
+
+	const TextureCacheHeader& header = *(const TextureCacheHeader*)mapping;
+
+	bool valid = memcmp(header.magic, "TXC", 4) == 0 &&
+				header.version == TEXTURE_CACHE_VERSION &&
+				header.sourceHash == sourceHash &&
+				header.sourceSize == sourceSize &&
+				header.components == TEXTURE_COMPONENTS &&
+				header.width == loader.width && header.height == loader.height &&
+				header.format == (loader.compress ? TEXTURE_FORMAT::BC1 : TEXTURE_FORMAT::RAW) &&
+				header.levels == mipLevels(header.width, header.height) &&
+				header.dataSize >= mipChainSize(header.width, header.height, header.components, header.levels, header.format) &&
+				header.dataOffset + header.dataSize <= (uint64_t)info.st_size;
+
+	if(!valid)
+	{
+		munmap(mapping, info.st_size);
+		return false;
+	}
+
+	load.mapping = mapping;
+	load.mappingSize = info.st_size;
+	load.pixels = (unsigned char*)mapping + header.dataOffset;
+	load.width = header.width;
+	load.height = header.height;
+	load.components = header.components;
+	load.levels = header.levels;
+	load.format = header.format;
+	load.psnr = header.psnr;
+	return true;
+}
+
+//Written to a temporary file first, so a half written cache never gets read
+static void writeCache(const TextureLoad& load, uint64_t sourceHash, uint64_t sourceSize)
+{
+	TextureCacheHeader header = {};
+	memcpy(header.magic, "TXC", 4);
+	header.version = TEXTURE_CACHE_VERSION;
+	header.sourceHash = sourceHash;
+	header.sourceSize = sourceSize;
+	header.width = load.width;
+	header.height = load.height;
+	header.components = load.components;
+	header.levels = load.levels;
+	header.format = load.format;
+	header.psnr = load.psnr;
+	header.dataOffset = (sizeof(header) + 63) & ~63;		//Texels start on a cache line
+	header.dataSize = mipChainSize(load.width, load.height, load.components, load.levels, load.format);
+
+	string path = cachePath(load.filename);
+	string temporary = path + ".tmp";
+
+	FILE* file = fopen(temporary.c_str(), "wb");
+	if(!file)
+		return;
+
+	char padding [64] = {0};
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fwrite(padding, 1, header.dataOffset - sizeof(header), file) == header.dataOffset - sizeof(header) &&
+			fwrite(load.pixels, header.dataSize, 1, file) == 1;
+	ok &= fclose(file) == 0;
+
+	if(!ok || rename(temporary.c_str(), path.c_str()) != 0)
+	{
+		cout << "Couldn't write texture cache " << path << endl;
+		remove(temporary.c_str());
+	}
+}
+
+//Swaps the decoded chain for a block compressed one, measuring how much the
+//top level lost on the way. Both buffers come from malloc, same as stbi's.
+static void compressChain(TextureLoad& load)
+{
+	int format = TEXTURE_FORMAT::BC1;
+	unsigned char* blocks = (unsigned char*)malloc(mipChainSize(load.width, load.height, load.components, load.levels, format));
+	if(!blocks)
+		return;
+
+	const unsigned char* src = load.pixels;
+	unsigned char* dst = blocks;
+	int width = load.width, height = load.height;
+	for(int i = 0; i < load.levels; i++)
+	{
+		compressImage(src, width, height, load.components, dst);
+
+		src += levelSize(width, height, load.components, TEXTURE_FORMAT::RAW);
+		dst += levelSize(width, height, load.components, format);
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+
+	size_t topSize = levelSize(load.width, load.height, load.components, TEXTURE_FORMAT::RAW);
+	vector<unsigned char> decoded(topSize);
+	decompressImage(blocks, load.width, load.height, load.components, decoded.data());
+	load.psnr = imagePSNR(load.pixels, decoded.data(), topSize);
+
+	free(load.pixels);
+	load.pixels = blocks;
+	load.format = format;
+}
+
+//Runs on a loader thread. The cache is tried first, it's only a map away;
+//otherwise it's a full decode, and the result gets cached for next time.
+static void loadImage(TextureLoad& load, TextureLoader& loader)
+{
+	vector<unsigned char> source;
+	if(!readFile(load.filename, source))
+		return;
+
+	uint64_t hash = fnv1a(source.data(), source.size());
+	if(loader.useCache && mapCache(load, loader, hash, source.size()))
+	{
+		loader.cacheHits++;
+		return;
+	}
+
+	//Whatever the file has, it comes out RGB
+	int channels;
+	load.pixels = stbi_load_from_memory(source.data(), source.size(), &load.width, &load.height, &channels, TEXTURE_COMPONENTS);
+	load.components = TEXTURE_COMPONENTS;
+	if(!load.pixels)
+		return;
+
+	//Halved while it's at least twice the layer size, so every pixel still
+	//counts. Safe in place, each pair of rows is summed before it's written over.
+	vector<unsigned short> sums;
+	while(load.width >= 2 * loader.width && load.height >= 2 * loader.height)
+	{
+		downsample(load.pixels, load.width, load.height, load.pixels, load.components, sums);
+		load.width /= 2;
+		load.height /= 2;
+	}
+
+	//Then stretched or squashed the rest of the way
+	if(load.width != loader.width || load.height != loader.height)
+	{
+		unsigned char* fitted = (unsigned char*)malloc(levelSize(loader.width, loader.height, load.components, TEXTURE_FORMAT::RAW));
+		if(fitted)
+			resample(load.pixels, load.width, load.height, fitted, loader.width, loader.height, load.components);
+
+		stbi_image_free(load.pixels);
+		load.pixels = fitted;
+		load.width = loader.width;
+		load.height = loader.height;
+		if(!load.pixels)
+			return;
+	}
+
+	//stbi allocates with plain malloc, so its buffer can grow to fit the chain.
+	//Every layer needs all its levels, so without room it's no use at all.
+	int levels = mipLevels(load.width, load.height);
+	unsigned char* chain = (unsigned char*)realloc(load.pixels, mipChainSize(load.width, load.height, load.components, levels));
+	if(!chain)
+	{
+		stbi_image_free(load.pixels);
+		load.pixels = 0;
+		return;
+	}
+
+	load.pixels = chain;
+	load.levels = levels;
+	generateMipmaps(load.pixels, load.width, load.height, load.components, levels);
+
+	if(loader.compress)
+		compressChain(load);
+
+	if(loader.useCache)
+		writeCache(load, hash, source.size());
+}
+
+static void releasePixels(TextureLoad& load)
+{
+	if(load.mapping)
+		munmap(load.mapping, load.mappingSize);
+	else
+		stbi_image_free(load.pixels);
+
+	load.mapping = 0;
+	load.pixels = 0;
+}
+
+//Queues filename to end up in the given layer, call before startTextureLoads
+void addTextureLoad(TextureLoader& loader, int layer, const char* filename)
+{
+	TextureLoad* load = new TextureLoad();
+	load->filename = filename;
+	load->layer = layer;
+	load->pixels = 0;
+	load->mapping = 0;
+	load->mappingSize = 0;
+	load->levels = 1;
+	load->format = TEXTURE_FORMAT::RAW;
+	load->psnr = 0.f;
+	load->decoded = false;
+	load->uploaded = false;
+	loader.loads.push_back(unique_ptr<TextureLoad>(load));
+}
+
+//One job per image, all decoding at once. Returns straight away.
+//Every image comes out width x height, the size of the array it's going into.
+//With useCache off, images are always decoded and no cache files get written.
+//With compress off, textures stay 8 bits a channel.
+bool startTextureLoads(TextureLoader& loader, int threads, int width, int height, bool useCache, bool compress)
+{
+	loader.pending = loader.loads.size();
+	loader.cancelled = false;
+	loader.useCache = useCache;
+	loader.compress = compress;
+	loader.width = width;
+	loader.height = height;
+	loader.cacheHits = 0;
+	loader.startTime = seconds();
+
+	//No more threads than images, a decode can't be split up
+	if(!createJobSystem(loader.jobs, std::min(threads, std::max(loader.pending, 1))))
+		return false;
+
+	for(int i = 0; i < loader.pending; i++)
+	{
+		TextureLoad* load = loader.loads[i].get();
+		TextureLoader* owner = &loader;
+
+		//stbi keeps nothing between calls apart from the fixed zlib tables,
+		//which PNGs fill in lazily but always with the same values (and
+		//flipping, which we never turn on), so they can all run at once
+		addJob(loader.jobs, [load, owner]() {
+			if(!owner->cancelled)
+				loadImage(*load, *owner);
+			load->decoded = true;
+		});
+	}
+
+	JobSystem* jobs = &loader.jobs;
+	loader.thread = thread([jobs]() { runJobs(*jobs); });
+	return true;
+}
+
+//Call once a frame. Uploads up to maxUploads finished images, so one frame
+//doesn't end up paying for all of them, and returns how many are still to go.
+int uploadLoadedTextures(TextureLoader& loader, TextureArray& array, int maxUploads)
+{
+	if(loader.pending == 0)
+		return 0;
+
+	int uploads = 0;
+	for(unsigned int i = 0; i < loader.loads.size() && uploads < maxUploads; i++)
+	{
+		TextureLoad& load = *loader.loads[i];
+		if(load.uploaded || !load.decoded)
+			continue;
+
+		if(load.pixels)
+		{
+			uploadTextureLayer(array, load.layer, load.pixels, load.format);
+			if(load.format != TEXTURE_FORMAT::RAW)
+				cout << load.filename << ": " << load.width << "x" << load.height << " " << textureFormatName(load.format) << ", "
+					 << mipChainSize(load.width, load.height, load.components, load.levels, load.format) / 1024 << " KB with mips, PSNR "
+					 << load.psnr << " dB" << endl;
+			releasePixels(load);
+		}
+		else
+			cout << "ERROR: couldn't load " << load.filename << endl;		//stbi's reason is a global, not ours to read
+
+		load.uploaded = true;
+		loader.pending--;
+		uploads++;
+	}
+
+	if(loader.pending == 0)
+	{
+		cout << "textures: " << loader.loads.size() << " loaded on " << jobThreadCount(loader.jobs)
+			 << " threads in " << 1000.0 * (seconds() - loader.startTime) << " ms ("
+			 << loader.cacheHits << " from the cache)" << endl;
+		finishTextureLoads(loader);
+	}
+
+	return loader.pending;
+}
+
+//Stops the loader, anything not decoded yet is skipped. Safe to call more than once.
+void finishTextureLoads(TextureLoader& loader)
+{
+	loader.cancelled = true;
+	if(loader.thread.joinable())
+		loader.thread.join();
+	deleteJobSystem(loader.jobs);
+
+	for(unsigned int i = 0; i < loader.loads.size(); i++)
+		releasePixels(*loader.loads[i]);
+}
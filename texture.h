@@ -0,0 +1,110 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#define GLFW_INCLUDE_GLCOREARB
+#define GL_GLEXT_PROTOTYPES
+#include <GLFW/glfw3.h>
+
+#include "jobs.h"
+#include "texcompress.h"
+
+using namespace glm;
+
+#define TEXTURE_CACHE_VERSION 4		//Bump whenever the layout below or what's stored changes
+
+//How textures get sampled when they're drawn smaller than they are
+//Access the values like so: TEXTURE_FILTER::TRILINEAR
+struct TEXTURE_FILTER{
+	enum {BILINEAR=0, TRILINEAR, ANISOTROPIC, COUNT};		// BILINEAR only ever reads the top level
+};
+
+#define MAX_ANISOTROPY 16.f
+
+// Every layer is the same size, so images get decoded as RGB and resampled to
+// fit. Nothing we draw needs alpha, which keeps the whole array BC1.
+#define TEXTURE_COMPONENTS 3
+
+// All the body textures as layers of one GL_TEXTURE_2D_ARRAY, so it's bound
+// once on unit 0 and the shader picks a layer per instance. The functions
+// below leave it bound there, nothing else ever uses that unit.
+struct TextureArray{
+	GLuint id;
+	int width, height, layers;
+	int levels;				// full chain down to 1x1
+	int format;				// TEXTURE_FORMAT it's kept in on the GPU, BC1 or RAW
+};
+
+// Start of a .texcache file, which holds an image already decoded so loading
+// it again is just mapping the file. It's only used if the source file it
+// came from hashes the same, otherwise it's decoded again and rewritten.
+struct TextureCacheHeader{
+	char magic [4];			// "TXC\0"
+	uint32_t version;		// TEXTURE_CACHE_VERSION
+	uint64_t sourceHash;	// FNV-1a of the whole source file
+	uint64_t sourceSize;
+	int32_t width, height, components;
+	int32_t levels;			// mip levels stored, one after another from the top
+	int32_t format;			// TEXTURE_FORMAT
+	float psnr;				// of the top level against the decoded image, if compressed
+	uint64_t dataOffset;	// from the start of the file
+	uint64_t dataSize;
+};
+
+// One image file on its way into a layer of the texture array. A job decodes it,
+// then the main thread uploads it (GL calls have to happen there).
+struct TextureLoad{
+	std::string filename;
+	int layer;
+	unsigned char* pixels;		// null until decoded, or if decoding failed
+	void* mapping;				// the cache file pixels points into, if it came from one
+	size_t mappingSize;
+	int width, height, components;
+	int levels;					// pixels holds the whole mip chain, biggest first
+	int format;					// TEXTURE_FORMAT
+	float psnr;
+	std::atomic<bool> decoded;
+	bool uploaded;
+};
+
+// Decodes a batch of images on its own job system, on a thread of its own so
+// the main thread can keep drawing. Layers start out as a single placeholder
+// colour and get swapped for the real image as each one finishes.
+struct TextureLoader{
+	std::vector<std::unique_ptr<TextureLoad>> loads;
+	JobSystem jobs;
+	std::thread thread;		// runs the batch, gone once everything's uploaded
+	std::atomic<bool> cancelled;
+	bool useCache;
+	bool compress;			// block compress everything that's decoded
+	int width, height;		// what every image gets resampled to, the array's size
+	std::atomic<int> cacheHits;
+	int pending;			// loads not uploaded yet
+	double startTime;
+};
+
+int mipLevels(int width, int height);
+size_t mipChainSize(int width, int height, int components, int levels, int format = TEXTURE_FORMAT::RAW);
+void generateMipmaps(unsigned char* pixels, int width, int height, int components, int levels);
+
+bool createTextureArray(TextureArray& array, int layers, int width, int height, bool compress = true);
+void fillTextureLayer(TextureArray& array, int layer, vec3 color);
+bool uploadTextureLayer(TextureArray& array, int layer, const unsigned char* pixels, int format);
+void setTextureFilter(TextureArray& array, int filter);
+const char* textureFilterName(int filter);
+void deleteTextureArray(TextureArray& array);
+
+void addTextureLoad(TextureLoader& loader, int layer, const char* filename);
+bool startTextureLoads(TextureLoader& loader, int threads, int width, int height, bool useCache = true, bool compress = true);
+int uploadLoadedTextures(TextureLoader& loader, TextureArray& array, int maxUploads = 1);
+void finishTextureLoads(TextureLoader& loader);
+
+#endif
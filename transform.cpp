@@ -0,0 +1,152 @@
+#include "transform.h"
+#include <cmath>
+#include <algorithm>
+
+//The SIMD kernels are x86 only. The AVX2 one is compiled for AVX2 on its own
+//through a target attribute, so the rest of the program still runs anywhere.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSFORM_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+//Rows of the rotation, glm stores columns so m[column][row]
+static void rotateAboutScalar(const mat3& m, vec3 c, PointsSoA& p, PointsSoA& n, int start)
+{
+	for(int i = start; i < p.count; i++)
+	{
+		float x = p.x[i] - c.x;
+		float y = p.y[i] - c.y;
+		float z = p.z[i] - c.z;
+
+		float rx = m[0][0] * x + m[1][0] * y + m[2][0] * z;
+		float ry = m[0][1] * x + m[1][1] * y + m[2][1] * z;
+		float rz = m[0][2] * x + m[1][2] * y + m[2][2] * z;
+
+		p.x[i] = rx + c.x;
+		p.y[i] = ry + c.y;
+		p.z[i] = rz + c.z;
+
+		float length = sqrt(rx * rx + ry * ry + rz * rz);
+		n.x[i] = rx / length;
+		n.y[i] = ry / length;
+		n.z[i] = rz / length;
+	}
+}
+
+#ifdef TRANSFORM_X86
+//4 points per iteration. SSE2 is always there on x86-64.
+static void rotateAboutSse(const mat3& m, vec3 c, PointsSoA& p, PointsSoA& n)
+{
+	__m128 m00 = _mm_set1_ps(m[0][0]), m10 = _mm_set1_ps(m[1][0]), m20 = _mm_set1_ps(m[2][0]);
+	__m128 m01 = _mm_set1_ps(m[0][1]), m11 = _mm_set1_ps(m[1][1]), m21 = _mm_set1_ps(m[2][1]);
+	__m128 m02 = _mm_set1_ps(m[0][2]), m12 = _mm_set1_ps(m[1][2]), m22 = _mm_set1_ps(m[2][2]);
+	__m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+
+	int i = 0;
+	for(; i + 4 <= p.count; i += 4)
+	{
+		__m128 x = _mm_sub_ps(_mm_loadu_ps(p.x + i), cx);
+		__m128 y = _mm_sub_ps(_mm_loadu_ps(p.y + i), cy);
+		__m128 z = _mm_sub_ps(_mm_loadu_ps(p.z + i), cz);
+
+		__m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m10, y)), _mm_mul_ps(m20, z));
+		__m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m01, x), _mm_mul_ps(m11, y)), _mm_mul_ps(m21, z));
+		__m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m02, x), _mm_mul_ps(m12, y)), _mm_mul_ps(m22, z));
+
+		_mm_storeu_ps(p.x + i, _mm_add_ps(rx, cx));
+		_mm_storeu_ps(p.y + i, _mm_add_ps(ry, cy));
+		_mm_storeu_ps(p.z + i, _mm_add_ps(rz, cz));
+
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), _mm_mul_ps(rz, rz)));
+		_mm_storeu_ps(n.x + i, _mm_div_ps(rx, length));
+		_mm_storeu_ps(n.y + i, _mm_div_ps(ry, length));
+		_mm_storeu_ps(n.z + i, _mm_div_ps(rz, length));
+	}
+
+	rotateAboutScalar(m, c, p, n, i);
+}
+
+//8 points per iteration, with fused multiply-adds
+__attribute__((target("avx2,fma")))
+static void rotateAboutAvx2(const mat3& m, vec3 c, PointsSoA& p, PointsSoA& n)
+{
+	__m256 m00 = _mm256_set1_ps(m[0][0]), m10 = _mm256_set1_ps(m[1][0]), m20 = _mm256_set1_ps(m[2][0]);
+	__m256 m01 = _mm256_set1_ps(m[0][1]), m11 = _mm256_set1_ps(m[1][1]), m21 = _mm256_set1_ps(m[2][1]);
+	__m256 m02 = _mm256_set1_ps(m[0][2]), m12 = _mm256_set1_ps(m[1][2]), m22 = _mm256_set1_ps(m[2][2]);
+	__m256 cx = _mm256_set1_ps(c.x), cy = _mm256_set1_ps(c.y), cz = _mm256_set1_ps(c.z);
+
+	int i = 0;
+	for(; i + 8 <= p.count; i += 8)
+	{
+		__m256 x = _mm256_sub_ps(_mm256_loadu_ps(p.x + i), cx);
+		__m256 y = _mm256_sub_ps(_mm256_loadu_ps(p.y + i), cy);
+		__m256 z = _mm256_sub_ps(_mm256_loadu_ps(p.z + i), cz);
+
+		__m256 rx = _mm256_fmadd_ps(m20, z, _mm256_fmadd_ps(m10, y, _mm256_mul_ps(m00, x)));
+		__m256 ry = _mm256_fmadd_ps(m21, z, _mm256_fmadd_ps(m11, y, _mm256_mul_ps(m01, x)));
+		__m256 rz = _mm256_fmadd_ps(m22, z, _mm256_fmadd_ps(m12, y, _mm256_mul_ps(m02, x)));
+
+		_mm256_storeu_ps(p.x + i, _mm256_add_ps(rx, cx));
+		_mm256_storeu_ps(p.y + i, _mm256_add_ps(ry, cy));
+		_mm256_storeu_ps(p.z + i, _mm256_add_ps(rz, cz));
+
+		__m256 length = _mm256_sqrt_ps(_mm256_fmadd_ps(rz, rz, _mm256_fmadd_ps(ry, ry, _mm256_mul_ps(rx, rx))));
+		_mm256_storeu_ps(n.x + i, _mm256_div_ps(rx, length));
+		_mm256_storeu_ps(n.y + i, _mm256_div_ps(ry, length));
+		_mm256_storeu_ps(n.z + i, _mm256_div_ps(rz, length));
+	}
+
+	rotateAboutScalar(m, c, p, n, i);
+}
+#endif
+
+static int detectTransformKernel()
+{
+	int kernel = TRANSFORM_KERNEL::SCALAR;
+
+#ifdef TRANSFORM_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("sse2"))
+		kernel = TRANSFORM_KERNEL::SSE;
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		kernel = TRANSFORM_KERNEL::AVX2;
+#endif
+
+	return kernel;
+}
+
+int bestTransformKernel()
+{
+	static int best = detectTransformKernel();
+	return best;
+}
+
+const char* transformKernelName(int kernel)
+{
+	const char* names[TRANSFORM_KERNEL::COUNT] = {"scalar", "SSE", "AVX2"};
+	return names[kernel];
+}
+
+void rotateAbout(const mat3& rotation, vec3 center, PointsSoA& points, PointsSoA& normals, int kernel)
+{
+	switch(std::min(kernel, bestTransformKernel()))
+	{
+#ifdef TRANSFORM_X86
+	case TRANSFORM_KERNEL::AVX2:
+		rotateAboutAvx2(rotation, center, points, normals);
+		break;
+	case TRANSFORM_KERNEL::SSE:
+		rotateAboutSse(rotation, center, points, normals);
+		break;
+#endif
+	default:
+		rotateAboutScalar(rotation, center, points, normals, 0);
+	}
+}
+
+void rotateAbout(const mat3& rotation, vec3 center, PointsSoA& points, PointsSoA& normals)
+{
+	rotateAbout(rotation, center, points, normals, bestTransformKernel());
+}
@@ -0,0 +1,35 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "glm/glm.hpp"
+
+using namespace glm;
+
+// A batch of points stored as structure of arrays, count long each. SIMD
+// kernels can then load 4 or 8 x's (y's, z's) at a time with no shuffling.
+// Arrays should be 32 byte aligned for the AVX2 kernel to run at full speed.
+struct PointsSoA{
+	float* x;
+	float* y;
+	float* z;
+	int count;
+};
+
+//Which instruction set the batch kernels run with, picked once at runtime
+struct TRANSFORM_KERNEL{
+	enum {SCALAR=0, SSE, AVX2, COUNT};
+};
+
+// Spins a body's vertices about its center, the same as the per-vertex
+// rotatePlanet loop did: points = rotation * (points - center) + center,
+// normals = normalize(points - center). Done in place.
+void rotateAbout(const mat3& rotation, vec3 center, PointsSoA& points, PointsSoA& normals);
+
+// The same with a specific kernel, for benchmarking. Asking for one the CPU
+// doesn't have falls back to the best one it does.
+void rotateAbout(const mat3& rotation, vec3 center, PointsSoA& points, PointsSoA& normals, int kernel);
+
+int bestTransformKernel();
+const char* transformKernelName(int kernel);
+
+#endif
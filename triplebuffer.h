@@ -0,0 +1,60 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+// Hands the newest copy of a T from one writer thread to one reader thread
+// without either of them ever waiting. There are three slots: the one the
+// writer is filling, the one the reader is looking at, and the last one
+// published, sitting in between. Publishing swaps the writer's slot with the
+// middle one, picking up swaps the reader's with it, both atomically.
+//
+// The reader always gets a complete copy, and the newest one there is. If
+// the writer publishes twice before the reader looks, the older one is
+// simply dropped.
+template <typename T>
+struct TripleBuffer{
+	T slots [3];
+	std::atomic<int> middle;	// slot index, plus TRIPLE_BUFFER_FRESH until the reader takes it
+	int writing;				// writer thread only
+	int reading;				// reader thread only
+};
+
+#define TRIPLE_BUFFER_FRESH 4
+
+//Fills every slot with value, call before either thread starts using it
+template <typename T>
+void initTripleBuffer(TripleBuffer<T>& buffer, const T& value)
+{
+	for(int i = 0; i < 3; i++)
+		buffer.slots[i] = value;
+
+	buffer.writing = 0;
+	buffer.middle = 1;
+	buffer.reading = 2;
+}
+
+//The writer's slot, fill it in then publish it
+template <typename T>
+T& writeSlot(TripleBuffer<T>& buffer)
+{
+	return buffer.slots[buffer.writing];
+}
+
+template <typename T>
+void publishSlot(TripleBuffer<T>& buffer)
+{
+	buffer.writing = buffer.middle.exchange(buffer.writing | TRIPLE_BUFFER_FRESH, std::memory_order_acq_rel) & 3;
+}
+
+//The newest published copy. It stays valid, and the same, until the next call.
+template <typename T>
+const T& latestSlot(TripleBuffer<T>& buffer)
+{
+	if(buffer.middle.load(std::memory_order_relaxed) & TRIPLE_BUFFER_FRESH)
+		buffer.reading = buffer.middle.exchange(buffer.reading, std::memory_order_acq_rel) & 3;
+
+	return buffer.slots[buffer.reading];
+}
+
+#endif
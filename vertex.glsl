@@ -7,28 +7,61 @@
 #version 410
 
 // location indices for these attributes correspond to those specified in the
-// InitializeGeometry() function of the main program
+// createMesh() and bindInstances() functions of the main program
 layout(location = 0) in vec3 VertexPosition;
+#if defined(PACKED_NORMALS)
+layout(location = 1) in vec2 VertexNormal;	// octahedral encoded, see octEncode in mesh.cpp
+#elif !defined(DERIVED_NORMALS)
 layout(location = 1) in vec3 VertexNormal;
+#endif
 layout(location = 2) in vec2 UV;
 
+// per instance: rotation + translation (locations 3-6) and
+// x = radius, y = texture layer, z = 1 if lit
+layout(location = 3) in mat4 InstanceTransform;
+layout(location = 7) in vec4 InstanceParams;
+
 out vec3 FragNormal;
 out vec2 FragUV;
 out vec4 spacePos;
+flat out int FragLayer;
+flat out int FragLit;
 
-uniform mat4 cameraMatrix;
-uniform mat4 perspectiveMatrix;
-uniform mat4 modelviewMatrix = mat4(1.f);
+// frame constants, written once per frame into the FrameData uniform buffer
+layout(std140) uniform FrameData {
+	mat4 cameraMatrix;
+	mat4 perspectiveMatrix;
+	vec4 lightPosition;
+	vec4 time;
+};
 // output to be interpolated between vertices and passed to the fragment stage
 
+// undoes octEncode from mesh.cpp for PACKED meshes, DERIVED_NORMALS meshes
+// are unit spheres so the normal is just the position
+vec3 objectNormal() {
+#if defined(DERIVED_NORMALS)
+	return normalize(VertexPosition);
+#elif defined(PACKED_NORMALS)
+	vec3 n = vec3(VertexNormal, 1.0 - abs(VertexNormal.x) - abs(VertexNormal.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+#else
+	return VertexNormal;
+#endif
+}
+
 void main()
 {
 	FragNormal = normalize(
-					(modelviewMatrix*vec4(VertexNormal, 0.f)).xyz
+					(InstanceTransform*vec4(objectNormal(), 0.f)).xyz
 				);
 
 	FragUV = UV;
+	FragLayer = int(InstanceParams.y + 0.5);
+	FragLit = int(InstanceParams.z + 0.5);
 
-	spacePos = modelviewMatrix * vec4(VertexPosition, 1.0);
-	gl_Position = perspectiveMatrix * cameraMatrix * modelviewMatrix*vec4(VertexPosition, 1.0);
+	// meshes are unit spheres, scale before placing them
+	spacePos = InstanceTransform * vec4(VertexPosition * InstanceParams.x, 1.0);
+	gl_Position = perspectiveMatrix * cameraMatrix * spacePos;
 }